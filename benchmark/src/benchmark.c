@@ -2,19 +2,30 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "ekjson/src/ekjson.h"
 
 #define ITERS 100
-#define NBENCHMARKS 7
+#define NBENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
 
 typedef int(benchmark_fn)(const char *);
 typedef void(cleanup_fn)(void);
 
-benchmark_fn benchmark_strlen, benchmark_ekjson, benchmark_jsmn,
+benchmark_fn benchmark_strlen, benchmark_ekjson, benchmark_ekjson_count,
+	benchmark_ekjson_hashes, benchmark_ekjson_parents,
+	benchmark_ekjson_filtered,
+	benchmark_ekjson_skip, benchmark_ekjson_strict,
+	benchmark_ekjson_validate,
+	benchmark_ekjson_validate_check, benchmark_jsmn,
 	benchmark_jjson, benchmark_simdjson, benchmark_jsonc,
 	benchmark_rapidjson;
-cleanup_fn cleanup_strlen, cleanup_ekjson, cleanup_jsmn, cleanup_jjson,
+cleanup_fn cleanup_strlen, cleanup_ekjson, cleanup_ekjson_count,
+	cleanup_ekjson_hashes, cleanup_ekjson_parents,
+	cleanup_ekjson_filtered, cleanup_ekjson_skip,
+	cleanup_ekjson_strict,
+	cleanup_ekjson_validate,
+	cleanup_ekjson_validate_check, cleanup_jsmn, cleanup_jjson,
 	cleanup_simdjson, cleanup_jsonc, cleanup_rapidjson;
 
 volatile int x;
@@ -44,6 +55,46 @@ static const struct benchmark {
 		.cleanup = cleanup_ekjson,
 		.name = "ekjson"
 	},
+	{
+		.fn = benchmark_ekjson_count,
+		.cleanup = cleanup_ekjson_count,
+		.name = "ekjson_count"
+	},
+	{
+		.fn = benchmark_ekjson_hashes,
+		.cleanup = cleanup_ekjson_hashes,
+		.name = "ekjson_hashes"
+	},
+	{
+		.fn = benchmark_ekjson_parents,
+		.cleanup = cleanup_ekjson_parents,
+		.name = "ekjson_parents"
+	},
+	{
+		.fn = benchmark_ekjson_filtered,
+		.cleanup = cleanup_ekjson_filtered,
+		.name = "ekjson_filtered"
+	},
+	{
+		.fn = benchmark_ekjson_skip,
+		.cleanup = cleanup_ekjson_skip,
+		.name = "ekjson_skip"
+	},
+	{
+		.fn = benchmark_ekjson_strict,
+		.cleanup = cleanup_ekjson_strict,
+		.name = "ekjson_strict"
+	},
+	{
+		.fn = benchmark_ekjson_validate,
+		.cleanup = cleanup_ekjson_validate,
+		.name = "ekjson_validate"
+	},
+	{
+		.fn = benchmark_ekjson_validate_check,
+		.cleanup = cleanup_ekjson_validate_check,
+		.name = "ekjson_validate_check"
+	},
 	{
 		.fn = benchmark_jjson,
 		.cleanup = cleanup_jjson,
@@ -142,6 +193,13 @@ extern char *flt_general_strings[], *flt_fast_strings[], *flt_slow_strings[];
 extern size_t flt_general_strings_len, flt_fast_strings_len,
        flt_slow_strings_len;
 
+int do_split_test(size_t mb, size_t maxthreads);
+int do_ndjson_test(size_t mb, size_t maxthreads);
+int do_find_test(void);
+int do_bind_test(void);
+int do_cursor_test(void);
+int do_query_test(void);
+
 int do_flt_test(void) {
 	flt_speed(2500000, "general", flt_general_strings,
 			flt_general_strings_len);
@@ -150,15 +208,79 @@ int do_flt_test(void) {
 	return 0;
 }
 
+// Names of ekjson's implementations (see enum ejimpl)
+static const char *const impls[] = {
+	[EJIMPL_SCALAR] = "scalar",
+	[EJIMPL_SSE2] = "sse2",
+	[EJIMPL_SSE42] = "sse42",
+	[EJIMPL_AVX2] = "avx2",
+	[EJIMPL_AVX512BW] = "avx512bw",
+};
+
+// Returns the implementation named by arg or -1 if its not one
+static int findimpl(const char *arg) {
+	for (int i = 0; i < EJIMPL_AUTO; i++) {
+		if (strcmp(arg, impls[i]) == 0) return i;
+	}
+	return -1;
+}
+
+// Only run the benchmarks named after the file, or all of them if none are
+static int selected(const char *name, int argc, char **argv) {
+	int any = 0;
+	for (int i = 2; i < argc; i++) {
+		if (findimpl(argv[i]) != -1) continue;
+		if (strcmp(argv[i], name) == 0) return 1;
+		any = 1;
+	}
+	return !any;
+}
+
 int main(int argc, char **argv) {
-	if (argc != 2) {
-		printf("usage: [./benchmark [file] | float]\n");
+	if (argc < 2) {
+		printf("usage: [./benchmark [file] [benchmarks...] [impl] "
+			"| float [impl] | split [mb] [impl] "
+			"| ndjson [mb] [impl] | find [impl] | bind [impl] "
+			"| cursor [impl] | query [impl]]\n");
+		printf("impl: scalar, sse2, sse42, avx2, avx512bw\n");
 		return 1;
 	}
 
+	// Pin ekjson to an implementation if one was given
+	for (int i = 2; i < argc; i++) {
+		const int impl = findimpl(argv[i]);
+		if (impl != -1 && !ejsetimpl(impl)) {
+			printf("%s is not supported on this cpu.\n", argv[i]);
+			return 1;
+		}
+	}
+	printf("ekjson implementation: %s\n", impls[ejgetimpl()]);
+
 	if (strcmp(argv[1], "float") == 0) {
 		return do_flt_test();
 	}
+	if (strcmp(argv[1], "split") == 0) {
+		const int mb = argc > 2 ? atoi(argv[2]) : 0;
+		return do_split_test(mb > 0 ? mb : 500,
+			sysconf(_SC_NPROCESSORS_ONLN));
+	}
+	if (strcmp(argv[1], "find") == 0) {
+		return do_find_test();
+	}
+	if (strcmp(argv[1], "bind") == 0) {
+		return do_bind_test();
+	}
+	if (strcmp(argv[1], "cursor") == 0) {
+		return do_cursor_test();
+	}
+	if (strcmp(argv[1], "query") == 0) {
+		return do_query_test();
+	}
+	if (strcmp(argv[1], "ndjson") == 0) {
+		const int mb = argc > 2 ? atoi(argv[2]) : 0;
+		return do_ndjson_test(mb > 0 ? mb : 500,
+			sysconf(_SC_NPROCESSORS_ONLN));
+	}
 
 	FILE *file = fopen(argv[1], "rb");
 	if (!file) {
@@ -177,6 +299,7 @@ int main(int argc, char **argv) {
 	clock_t total_time[NBENCHMARKS];
 
 	double throughput[NBENCHMARKS];
+	int ekjson = -1;
 
 	size_t filelen = strlen(str);
 	printf("file len: %zu\n", filelen);
@@ -184,6 +307,9 @@ int main(int argc, char **argv) {
 
 	for (int b = 0; b < NBENCHMARKS; b++) {
 		clock_t times[ITERS];
+		throughput[b] = 0.0;
+		if (!selected(benchmarks[b].name, argc, argv)) continue;
+		if (strcmp(benchmarks[b].name, "ekjson") == 0) ekjson = b;
 		warmup(str);
 
 		for (int i = 0; i < ITERS; i++) {
@@ -209,8 +335,11 @@ int main(int argc, char **argv) {
 		printf("time total (%d iters) (ms): %f\n", ITERS,
 			(double)total_time[b]
 			/ ((double)CLOCKS_PER_SEC / 1000.0f));
-		printf("%% of ekjson time (in total): %f%%\n",
-			(double)total_time[b] / (double)total_time[1] * 100.0f);
+		if (ekjson != -1) {
+			printf("%% of ekjson time (in total): %f%%\n",
+				(double)total_time[b]
+				/ (double)total_time[ekjson] * 100.0f);
+		}
 		double secs = avg_time[b] / (double)CLOCKS_PER_SEC;
 		throughput[b] = ((double)filelen / 1024.0 / 1024.0 / 1024.0)
 			/ secs;
@@ -221,7 +350,8 @@ int main(int argc, char **argv) {
 
 	printf("%d\n", x);
 	for (int i = 0; i < NBENCHMARKS; i++) {
-		printf("%.3f, ", throughput[i]);
+		if (!selected(benchmarks[i].name, argc, argv)) continue;
+		printf("%s %.3f, ", benchmarks[i].name, throughput[i]);
 	}
 	printf("\n");
 
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ekjson/src/ekjson.h"
+
+// Number of messages and how many times they're all decoded
+#define NMSGS (1 << 14)
+#define ITERS 20
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+typedef struct params {
+	int64_t x, y;
+	double scale;
+} params_t;
+
+typedef struct request {
+	int64_t id;
+	char method[32];
+	bool notify;
+	params_t params;
+} request_t;
+
+static ejschema_t params_schema, request_schema;
+static const ejfield_t params_fields[] = {
+	{ "x", EJINT, offsetof(params_t, x), sizeof(int64_t) },
+	{ "y", EJINT, offsetof(params_t, y), sizeof(int64_t) },
+	{ "scale", EJFLT, offsetof(params_t, scale), sizeof(double) },
+};
+static const ejfield_t request_fields[] = {
+	{ "id", EJINT, offsetof(request_t, id), sizeof(int64_t) },
+	{ "method", EJSTR, offsetof(request_t, method), 32 },
+	{ "notify", EJBOOL, offsetof(request_t, notify), sizeof(bool) },
+	{ "params", EJOBJ, offsetof(request_t, params), sizeof(params_t),
+		&params_schema },
+};
+
+// Makes an rpc request that has some keys the schema doesn't know about
+static int genmsg(char *s, unsigned i) {
+	return sprintf(s, "{\"jsonrpc\": \"2.0\", \"id\": %u, "
+		"\"method\": \"move_%u\", \"notify\": %s, "
+		"\"params\": {\"x\": %u, \"y\": -%u, \"scale\": %u.%03u, "
+		"\"tags\": [\"a\", \"b\", {\"c\": null}]}, "
+		"\"trace\": {\"span\": \"%08x\", \"sampled\": true}}",
+		i, i % 16, i % 3 ? "false" : "true", i * 7u, i * 13u,
+		i % 10, i % 1000, i * 2654435761u);
+}
+
+// Times ejparse and then ejbind against ejparse_bind on small messages
+int do_bind_test(void) {
+	char *const buf = malloc(NMSGS * 256);
+	const char **msgs = malloc(NMSGS * sizeof(*msgs));
+	request_t *reqs = malloc(NMSGS * sizeof(*reqs));
+	ejtok_t t[64];
+	uint64_t params_slots[4], request_slots[8];
+	if (!buf || !msgs || !reqs
+		|| !ejschema(&params_schema, params_fields, 3, params_slots, 4)
+		|| !ejschema(&request_schema, request_fields, 4,
+			request_slots, 8)) {
+		printf("error!!!\n");
+		return -1;
+	}
+
+	size_t len = 0;
+	char *s = buf;
+	for (unsigned i = 0; i < NMSGS; i++) {
+		msgs[i] = s;
+		const int n = genmsg(s, i);
+		s += n + 1;
+		len += n;
+	}
+	const double megs = (double)len * ITERS / 1024.0 / 1024.0;
+
+	double start = now();
+	for (int it = 0; it < ITERS; it++) {
+		for (size_t i = 0; i < NMSGS; i++) {
+			if (ejparse(msgs[i], t, 64).err
+				|| !ejbind(&request_schema, msgs[i], t, NULL,
+					reqs + i)) {
+				printf("error!!!\n");
+				return -1;
+			}
+		}
+	}
+	const double twopass = now() - start;
+
+	start = now();
+	for (int it = 0; it < ITERS; it++) {
+		for (size_t i = 0; i < NMSGS; i++) {
+			if (ejparse_bind(msgs[i], &request_schema,
+				reqs + i).err) {
+				printf("error!!!\n");
+				return -1;
+			}
+		}
+	}
+	const double fused = now() - start;
+
+	printf("ejparse + ejbind: %.1f MB/s, %.1f ns/msg\n", megs / twopass,
+		twopass / NMSGS / ITERS * 1e9);
+	printf("ejparse_bind:     %.1f MB/s, %.1f ns/msg (%.2fx)\n",
+		megs / fused, fused / NMSGS / ITERS * 1e9, twopass / fused);
+	free(reqs);
+	free(msgs);
+	free(buf);
+	return 0;
+}
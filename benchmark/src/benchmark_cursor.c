@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ekjson/src/ekjson.h"
+
+// Number of records in the document and how many times it's read
+#define NRECS 2000
+#define ITERS 2000
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Makes a ~200KB response where the fields a handler wants are around a big
+// array of records that it doesn't
+static size_t gendoc(char *s) {
+	char *const start = s;
+	s += sprintf(s, "{\"id\": 12345, \"items\": [");
+	for (unsigned i = 0; i < NRECS; i++) {
+		s += sprintf(s, "%s{\"sku\": \"item-%05u\", \"price\": %u.%02u, "
+			"\"tags\": [\"a\", \"b\\\"c\"], \"stock\": %u}",
+			i ? ", " : "", i, i % 500, i % 100, i * 7 % 1000);
+	}
+	s += sprintf(s, "], \"user\": {\"id\": 42, \"name\": \"ek\"}, "
+		"\"status\": \"ok\"}");
+	return s - start;
+}
+
+// Goes through the keys of the object token at obj to find key
+static const ejtok_t *tokfind(const char *src, const ejtok_t *obj,
+				const char *key) {
+	for (uint32_t i = 1; i < obj->len; i += obj[i].len) {
+		if (ejcmp(src + obj[i].start, key)) return obj + i + 1;
+	}
+	return NULL;
+}
+
+// Times reading 4 fields with ejparse against reading them with a cursor
+int do_cursor_test(void) {
+	char *const src = malloc(NRECS * 128 + 256);
+	const size_t nt = NRECS * 16 + 64;
+	ejtok_t *const t = malloc(nt * sizeof(*t));
+	if (!src || !t) {
+		printf("error!!!\n");
+		return -1;
+	}
+	const size_t len = gendoc(src);
+	const double megs = (double)len * ITERS / 1024.0 / 1024.0;
+	int64_t sum = 0;
+
+	double start = now();
+	for (int it = 0; it < ITERS; it++) {
+		if (ejparse(src, t, nt).err) {
+			printf("error!!!\n");
+			return -1;
+		}
+		const ejtok_t *const user = tokfind(src, t, "user");
+		const ejtok_t *const id = tokfind(src, t, "id");
+		const ejtok_t *const uid = user ? tokfind(src, user, "id") : NULL;
+		const ejtok_t *const st = tokfind(src, t, "status");
+		if (!id || !uid || !st || !ejcmp(src + st->start, "ok")) {
+			printf("error!!!\n");
+			return -1;
+		}
+		sum += ejint(src + id->start) + ejint(src + uid->start);
+	}
+	const double parsed = now() - start;
+
+	start = now();
+	for (int it = 0; it < ITERS; it++) {
+		const ejcursor_t root = ejcursor(src);
+		ejcursor_t id = root, uid = root, st = root;
+		if (!ejcursor_find(&id, "id") || !ejcursor_find(&uid, "user")
+			|| !ejcursor_find(&uid, "id")
+			|| !ejcursor_find(&st, "status")
+			|| !ejcmp(st.val, "ok")) {
+			printf("error!!!\n");
+			return -1;
+		}
+		sum -= ejint(id.val) + ejint(uid.val);
+	}
+	const double lazy = now() - start;
+
+	printf("ejparse + tokens: %.1f MB/s, %.1f us/doc\n", megs / parsed,
+		parsed / ITERS * 1e6);
+	printf("ejcursor:         %.1f MB/s, %.1f us/doc (%.2fx)\n",
+		megs / lazy, lazy / ITERS * 1e6, parsed / lazy);
+	free(t);
+	free(src);
+	return sum != 0;
+}
@@ -3,6 +3,8 @@
 #define N 1024*1024
 
 static ejtok_t t[N];
+static uint64_t hashes[N];
+static uint32_t parents[N];
 
 int benchmark_ekjson(const char *src) {
 	// 16k tokens (16k*8B of data)
@@ -22,3 +24,80 @@ void cleanup_ekjson(void) {
 
 }
 
+// Just the token count pre-pass, to compare against a whole ejparse
+int benchmark_ekjson_count(const char *src) {
+	const ejsize_t size = ejcount(src);
+	return size.ntoks >= N;
+}
+
+void cleanup_ekjson_count(void) {
+
+}
+
+
+// ejparse with the keys hashed as they're parsed, to compare against ejparse
+int benchmark_ekjson_hashes(const char *src) {
+	return ejparse_hashes(src, t, N, hashes).err;
+}
+
+void cleanup_ekjson_hashes(void) {
+
+}
+
+// ejparse with the parent of every token put down, to compare against ejparse
+int benchmark_ekjson_parents(const char *src) {
+	return ejparse_parents(src, t, N, parents).err;
+}
+
+void cleanup_ekjson_parents(void) {
+
+}
+
+// Only the ids of the records (of samples/fgo.json), to compare against ejparse
+int benchmark_ekjson_filtered(const char *src) {
+	static const char *const paths[] = { "[*].id" };
+	static ejstep_t steps[4];
+	static ejfilter_t filter;
+	if (!filter.steps && !ejfilter(&filter, paths, 1, steps, 4)) return 1;
+	return ejparse_filtered(src, &filter, t, N).err;
+}
+
+void cleanup_ekjson_filtered(void) {
+
+}
+
+// Jumping over the whole document, to compare against ejparse
+int benchmark_ekjson_skip(const char *src) {
+	return !ejskip(src);
+}
+
+void cleanup_ekjson_skip(void) {
+
+}
+
+// ejparse with UTF-8 and surrogates checked, to compare against ejparse
+int benchmark_ekjson_strict(const char *src) {
+	return ejparse_strict(src, t, N).err;
+}
+
+void cleanup_ekjson_strict(void) {
+
+}
+
+// Only checking the document, to compare against ejparse
+int benchmark_ekjson_validate(const char *src) {
+	return ejvalidate(src, false).err;
+}
+
+void cleanup_ekjson_validate(void) {
+
+}
+
+// Checking the document and every string and number in it
+int benchmark_ekjson_validate_check(const char *src) {
+	return ejvalidate(src, true).err;
+}
+
+void cleanup_ekjson_validate_check(void) {
+
+}
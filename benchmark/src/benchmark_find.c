@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ekjson/src/ekjson.h"
+
+// Number of lookups for each object size
+#define NLOOKUPS (1 << 20)
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Makes an object with n keys named "field_0", "field_1", ...
+static char *genobject(size_t n) {
+	char *str = malloc(n * 32 + 8), *s = str;
+	if (!str) return NULL;
+
+	*s++ = '{';
+	for (size_t i = 0; i < n; i++) {
+		s += sprintf(s, "%s\"field_%zu\": %zu", i ? ", " : "", i, i);
+	}
+	*s++ = '}', *s = '\0';
+	return str;
+}
+
+// Finds the key the same way as examples/object does
+static const ejtok_t *scan(const char *src, const ejtok_t *obj,
+			const char *key) {
+	for (uint32_t i = 1; i < obj->len; i += obj[i].len) {
+		if (ejcmp(src + obj[i].start, key)) return obj + i;
+	}
+	return NULL;
+}
+
+// Times looking up random keys with ejcmp on every key against ejfind on
+// objects with more and more keys
+int do_find_test(void) {
+	for (size_t n = 4; n <= 4096; n *= 4) {
+		char *src = genobject(n);
+		ejtok_t *t = malloc((n * 2 + 3) * sizeof(*t));
+		uint64_t *slots = malloc(n * 4 * sizeof(*slots));
+		char (*keys)[32] = malloc(NLOOKUPS * sizeof(*keys));
+		if (!src || !t || !slots || !keys
+			|| ejparse(src, t, n * 2 + 3).err) {
+			printf("error!!!\n");
+			return -1;
+		}
+		srand(n);
+		for (size_t i = 0; i < NLOOKUPS; i++) {
+			sprintf(keys[i], "field_%zu", (size_t)rand() % n);
+		}
+
+		double start = now();
+		size_t found = 0;
+		for (size_t i = 0; i < NLOOKUPS; i++) {
+			found += scan(src, t, keys[i]) != NULL;
+		}
+		const double linear = now() - start;
+
+		start = now();
+		ejindex_t index;
+		ejindex(&index, src, t, NULL, slots, n * 4);
+		const double build = now() - start;
+		for (size_t i = 0; i < NLOOKUPS; i++) {
+			found += ejfind(&index, keys[i]) != NULL;
+		}
+		const double hashed = now() - start;
+		if (found != NLOOKUPS * 2) {
+			printf("error!!!\n");
+			return -1;
+		}
+
+		printf("%4zu keys: ejcmp scan %.1f ns, ejfind %.1f ns "
+			"(%.2fx, ejindex %.1f us)\n", n,
+			linear / NLOOKUPS * 1e9, hashed / NLOOKUPS * 1e9,
+			linear / hashed, build * 1e6);
+		free(keys);
+		free(slots);
+		free(t);
+		free(src);
+	}
+	return 0;
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ekjson/src/ekjson.h"
+
+#define ITERS 5
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Makes newline-delimited log records that are about mb megabytes in total
+static char *genlines(size_t mb, size_t *len, size_t *nlines) {
+	const size_t cap = mb * 1024 * 1024 + 256;
+	char *str = malloc(cap), *s = str;
+	if (!str) return NULL;
+
+	*nlines = 0;
+	for (unsigned i = 0; (size_t)(s - str) < cap - 256; i++, ++*nlines) {
+		s += sprintf(s, "{\"ts\": %u, \"level\": \"%s\", "
+			"\"msg\": \"request \\\"%u\\\" done\", "
+			"\"latency\": %u.%03u, \"tags\": [\"api\", \"v2\"], "
+			"\"user\": {\"id\": %u, \"admin\": %s}}\n",
+			1700000000u + i, i % 7 ? "info" : "warn",
+			i * 7919u % 100000u, i % 1000u, i % 997u, i % 50000u,
+			i % 13 ? "false" : "true");
+	}
+	*s = '\0';
+	*len = s - str;
+	return str;
+}
+
+// Times ejparse_many against a pool with more and more threads on generated
+// log lines
+int do_ndjson_test(size_t mb, size_t maxthreads) {
+	size_t len, nlines;
+	char *src = genlines(mb, &len, &nlines);
+	if (!src) {
+		printf("couldn't allocate the lines.\n");
+		return 1;
+	}
+	printf("ndjson len: %zu (%zu lines)\n", len, nlines);
+
+	const size_t nt = len / 4;
+	ejtok_t *t = malloc(nt * sizeof(*t));
+	ejdoc_t *docs = malloc(nlines * sizeof(*docs));
+	if (!t || !docs) {
+		printf("couldn't allocate the buffers.\n");
+		return 1;
+	}
+	const double gigs = (double)len / 1024.0 / 1024.0 / 1024.0;
+
+	double start = now();
+	for (int i = 0; i < ITERS; i++) {
+		const ejmany_t res = ejparse_many(src, t, nt, docs, nlines);
+		if (res.next || res.ndocs != nlines) {
+			printf("error!!!\n");
+			return -1;
+		}
+	}
+	const double base = (now() - start) / ITERS;
+	printf("ejparse_many: %.3f GB/s\n", gigs / base);
+	free(docs);
+	free(t);
+
+	if (maxthreads > EKJSON_MAX_THREADS) maxthreads = EKJSON_MAX_THREADS;
+	for (size_t n = 1; n <= maxthreads;
+		n = n < maxthreads && n * 2 > maxthreads ? maxthreads : n * 2) {
+		ejpool_t pool;
+		if (!ejpool_init(&pool, n)) {
+			printf("couldn't start %zu threads.\n", n);
+			return 1;
+		}
+
+		// The first batch grows the buffers, so leave it out
+		ejpool_many(&pool, src, len);
+		start = now();
+		for (int i = 0; i < ITERS; i++) {
+			if (!ejpool_many(&pool, src, len)) {
+				printf("error!!!\n");
+				return -1;
+			}
+		}
+		const double time = (now() - start) / ITERS;
+
+		size_t ndocs = 0;
+		for (size_t i = 0; i < pool.nthreads; i++) {
+			ndocs += pool.shards[i].ndocs;
+		}
+		if (ndocs != nlines) {
+			printf("error!!!\n");
+			return -1;
+		}
+		printf("ejpool %zu threads: %.3f GB/s (%.2fx ejparse_many)\n",
+			n, gigs / time, base / time);
+		ejpool_free(&pool);
+	}
+
+	free(src);
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ekjson/src/ekjson.h"
+
+// Number of documents, how many tokens each one gets and how many times
+// they're all looked up in
+#define NDOCS (1 << 10)
+#define NTOKS 64
+#define ITERS 1000
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Makes a user event with the city a few objects down, after other keys
+static int gendoc(char *s, unsigned i) {
+	return sprintf(s, "{\"id\": %u, \"kind\": \"event\", \"time\": %u, "
+		"\"meta\": {\"source\": \"app_%u\", \"tags\": [\"a\", \"b\"], "
+		"\"region\": \"eu\"}, \"session\": \"%08x\", "
+		"\"user\": {\"name\": \"user_%u\", \"email\": \"u%u@mail\", "
+		"\"age\": %u, \"address\": {\"street\": \"%u main st\", "
+		"\"zip\": \"%05u\", \"city\": \"city_%u\"}}, "
+		"\"items\": [1, 2, 3]}",
+		i, i * 7u, i % 8, i * 2654435761u, i, i, 20 + i % 50,
+		i, i % 100000, i % 100);
+}
+
+// Finds a key the way examples/object does
+static const ejtok_t *member(const char *src, const ejtok_t *obj,
+				const char *key) {
+	if (obj->type != EJOBJ) return NULL;
+	for (uint32_t i = 1; i < obj->len; i += obj[i].len) {
+		if (ejcmp(src + obj[i].start, key)) return obj + i + 1;
+	}
+	return NULL;
+}
+
+// Times a hand written lookup of user.address.city with ejcmp against the
+// same path compiled once with ejpath and looked up with ejquery, with and
+// without the key hashes from ejparse_hashes
+int do_query_test(void) {
+	char *const buf = malloc(NDOCS * 512);
+	const char **docs = malloc(NDOCS * sizeof(*docs));
+	ejtok_t *t = malloc(NDOCS * NTOKS * sizeof(*t));
+	uint64_t *hashes = malloc(NDOCS * NTOKS * sizeof(*hashes));
+	ejstep_t steps[4];
+	ejpath_t path;
+	if (!buf || !docs || !t || !hashes
+		|| !ejpath(&path, "/user/address/city", steps, 4)) {
+		printf("error!!!\n");
+		return -1;
+	}
+
+	char *s = buf;
+	for (unsigned i = 0; i < NDOCS; i++) {
+		docs[i] = s;
+		s += gendoc(s, i) + 1;
+		if (ejparse_hashes(docs[i], t + i * NTOKS, NTOKS,
+			hashes + i * NTOKS).err) {
+			printf("error!!!\n");
+			return -1;
+		}
+	}
+
+	size_t found = 0;
+	double start = now();
+	for (int it = 0; it < ITERS; it++) {
+		for (size_t i = 0; i < NDOCS; i++) {
+			const ejtok_t *v = member(docs[i], t + i * NTOKS,
+						"user");
+			if (v) v = member(docs[i], v, "address");
+			if (v) v = member(docs[i], v, "city");
+			found += v != NULL;
+		}
+	}
+	const double linear = now() - start;
+
+	start = now();
+	for (int it = 0; it < ITERS; it++) {
+		for (size_t i = 0; i < NDOCS; i++) {
+			found += ejquery(&path, docs[i], t + i * NTOKS,
+					NULL) != NULL;
+		}
+	}
+	const double query = now() - start;
+
+	start = now();
+	for (int it = 0; it < ITERS; it++) {
+		for (size_t i = 0; i < NDOCS; i++) {
+			found += ejquery(&path, docs[i], t + i * NTOKS,
+					hashes + i * NTOKS) != NULL;
+		}
+	}
+	const double hashed = now() - start;
+	if (found != (size_t)NDOCS * ITERS * 3) {
+		printf("error!!!\n");
+		return -1;
+	}
+
+	const double n = (double)NDOCS * ITERS;
+	printf("ejcmp by hand:      %.1f ns/doc\n", linear / n * 1e9);
+	printf("ejquery:            %.1f ns/doc (%.2fx)\n", query / n * 1e9,
+		linear / query);
+	printf("ejquery + hashes:   %.1f ns/doc (%.2fx)\n", hashed / n * 1e9,
+		linear / hashed);
+	free(hashes);
+	free(t);
+	free(docs);
+	free(buf);
+	return 0;
+}
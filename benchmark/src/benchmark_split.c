@@ -0,0 +1,124 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ekjson/src/ekjson.h"
+
+#define ITERS 5
+#define MAXTHREADS 64
+
+// Everything a thread needs to parse its part of the array
+struct worker {
+	pthread_t thread;
+	pthread_barrier_t *barrier;
+	const char *src;
+	size_t len;
+	ejtok_t *t;
+	size_t nt;
+	ejpart_t *parts;
+	size_t nparts, i;
+};
+
+static void *work(void *arg) {
+	struct worker *w = arg;
+	ejsplit_scan(w->src, w->len, w->parts, w->nparts, w->i);
+	pthread_barrier_wait(w->barrier);
+	ejsplit_parse(w->src, w->len, w->t, w->nt, w->parts, w->nparts, w->i);
+	return NULL;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Makes a top-level array of records that is about mb megabytes
+static char *genarray(size_t mb, size_t *len) {
+	const size_t cap = mb * 1024 * 1024 + 256;
+	char *str = malloc(cap), *s = str;
+	if (!str) return NULL;
+
+	*s++ = '[';
+	for (unsigned i = 0; (size_t)(s - str) < cap - 256; i++) {
+		s += sprintf(s, "%s\n\t{\"id\": %u, "
+			"\"name\": \"user \\\"%u\\\"\", "
+			"\"score\": %u.%02u, \"tags\": [\"a\", \"b[,]\"], "
+			"\"active\": %s, \"parent\": null}",
+			i ? "," : "", i, i * 7919u % 100000u, i % 1000u,
+			i % 100u, i % 3 ? "true" : "false");
+	}
+	*s++ = '\n', *s++ = ']', *s = '\0';
+	*len = s - str;
+	return str;
+}
+
+// Times ejparse against the split parser with more and more threads on a
+// generated array
+int do_split_test(size_t mb, size_t maxthreads) {
+	size_t len;
+	char *src = genarray(mb, &len);
+	if (!src) {
+		printf("couldn't allocate the array.\n");
+		return 1;
+	}
+	printf("array len: %zu\n", len);
+
+	const size_t nt = ejcount(src).ntoks + 2;
+	ejtok_t *t = malloc(nt * sizeof(*t));
+	if (!t) {
+		printf("couldn't allocate %zu tokens.\n", nt);
+		return 1;
+	}
+	const double gigs = (double)len / 1024.0 / 1024.0 / 1024.0;
+
+	double start = now();
+	for (int i = 0; i < ITERS; i++) {
+		if (ejparse(src, t, nt).err) {
+			printf("error!!!\n");
+			return -1;
+		}
+	}
+	const double base = (now() - start) / ITERS;
+	printf("ejparse: %.3f GB/s\n", gigs / base);
+
+	if (maxthreads > MAXTHREADS) maxthreads = MAXTHREADS;
+	for (size_t n = 1; n <= maxthreads;
+		n = n < maxthreads && n * 2 > maxthreads ? maxthreads : n * 2) {
+		struct worker workers[MAXTHREADS];
+		ejpart_t parts[MAXTHREADS];
+		pthread_barrier_t barrier;
+		pthread_barrier_init(&barrier, NULL, n);
+
+		start = now();
+		for (int i = 0; i < ITERS; i++) {
+			for (size_t w = 0; w < n; w++) {
+				workers[w] = (struct worker){
+					.barrier = &barrier,
+					.src = src, .len = len,
+					.t = t, .nt = nt,
+					.parts = parts, .nparts = n, .i = w,
+				};
+				pthread_create(&workers[w].thread, NULL, work,
+					workers + w);
+			}
+			for (size_t w = 0; w < n; w++) {
+				pthread_join(workers[w].thread, NULL);
+			}
+			if (ejsplit_join(t, parts, n).err) {
+				printf("error!!!\n");
+				return -1;
+			}
+		}
+		const double time = (now() - start) / ITERS;
+		printf("ejsplit %zu threads: %.3f GB/s (%.2fx ejparse)\n",
+			n, gigs / time, base / time);
+		pthread_barrier_destroy(&barrier);
+	}
+
+	free(t);
+	free(src);
+	return 0;
+}
@@ -1,7 +1,79 @@
 #include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "ekjson.h"
+
+typedef struct window {
+	int32_t width;
+	int32_t height;
+} window_t;
+
+typedef struct config {
+	char title[32];
+	bool fullscreen;
+	float volume;
+	window_t window;
+	int16_t max_fps;
+} config_t;
+
+// Where each key goes in the structs
+static ejschema_t window_schema, config_schema;
+static const ejfield_t window_fields[] = {
+	{ "width", EJINT, offsetof(window_t, width), sizeof(int32_t) },
+	{ "height", EJINT, offsetof(window_t, height), sizeof(int32_t) },
+};
+static const ejfield_t config_fields[] = {
+	{ "title", EJSTR, offsetof(config_t, title), 32 },
+	{ "fullscreen", EJBOOL, offsetof(config_t, fullscreen), sizeof(bool) },
+	{ "volume", EJFLT, offsetof(config_t, volume), sizeof(float) },
+	{ "window", EJOBJ, offsetof(config_t, window), sizeof(window_t),
+		&window_schema },
+	{ "max_fps", EJINT, offsetof(config_t, max_fps), sizeof(int16_t) },
+};
+
+bool load_config(const char *src, ejtok_t *tokens, config_t *config) {
+	static uint64_t window_slots[4], config_slots[8];
+	if (!ejschema(&window_schema, window_fields,
+		sizeof(window_fields)/sizeof(window_fields[0]),
+		window_slots, 4)) return false;
+	if (!ejschema(&config_schema, config_fields,
+		sizeof(config_fields)/sizeof(config_fields[0]),
+		config_slots, 8)) return false;
+
+	// Defaults for the keys that aren't in the file
+	*config = (config_t){
+		.title = "untitled",
+		.volume = 1.0f,
+		.window = { 640, 480 },
+		.max_fps = 60,
+	};
+	return ejbind(&config_schema, src, tokens, NULL, config);
+}
+
+void config_print(const config_t *config) {
+	printf("config\n");
+	printf("\ttitle: %s\n", config->title);
+	printf("\tfullscreen: %s\n", config->fullscreen ? "true" : "false");
+	printf("\tvolume: %f\n", config->volume);
+	printf("\twindow: %dx%d\n", config->window.width,
+		config->window.height);
+	printf("\tmax_fps: %d\n", config->max_fps);
+}
 
 int main(int argc, char **argv) {
-	printf("coming soon.\n");
+	ejtok_t tokens[32];
+	char *file = file_load_str("config.json");
+	if (!file) return 1;
+
+	if (ejparse(file, tokens, sizeof(tokens)/sizeof(tokens[0])).err) {
+		return 1;
+	}
+
+	config_t config;
+	if (!load_config(file, tokens, &config)) return 1;
+	config_print(&config);
+
+	free(file);
 	return 0;
 }
-
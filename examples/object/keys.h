@@ -0,0 +1,54 @@
+// Don't touch this file, this is auto generated by genkeys.py
+// Also include stdint.h and ekjson.h before this
+#ifndef _keys_h_
+#define _keys_h_
+
+// Ids of the keys
+enum human_key {
+	HUMAN_NAME,
+	HUMAN_AGE,
+	HUMAN_STRENGTH,
+	HUMAN_HP,
+	HUMAN_PERCENTILE,
+	HUMAN_NKEYS,
+};
+
+// Returns the id of the key token at tok_start (first quote), or -1
+// if it isn't one of the keys. The length and first and last 8
+// bytes of the key pick the only key that it can be, and then ejcmp
+// makes sure that it's that one.
+static int human_key(const char *tok_start) {
+	static const char *const keys[] = {
+		"name",
+		"age",
+		"strength",
+		"hp",
+		"percentile",
+	};
+	static const signed char slots[8] = {
+		1, -1, 0, -1, -1, 4, 3, 2,
+	};
+
+	const char *const src = tok_start + 1;
+	size_t len = 0;
+	for (; src[len] != '"'; len++) {
+		// Keys with escapes are rare, so just compare them
+		if (src[len] != '\\') continue;
+		for (int i = 0; i < HUMAN_NKEYS; i++) {
+			if (ejcmp(tok_start, keys[i])) return i;
+		}
+		return -1;
+	}
+
+	const size_t m = len < 8 ? len : 8;
+	uint64_t first = 0, last = 0;
+	for (size_t i = 0; i < m; i++) {
+		first |= (uint64_t)(uint8_t)src[i] << i * 8;
+		last |= (uint64_t)(uint8_t)src[len - m + i] << i * 8;
+	}
+	const uint64_t x = (first ^ len) + last * 0x9E3779B97F4A7C15ull;
+	const int id = slots[x * 0xD76D4330F1446BEBull >> 61];
+	return id >= 0 && ejcmp(tok_start, keys[id]) ? id : -1;
+}
+
+#endif // _keys_h_
@@ -4,6 +4,10 @@
 #include "common.h"
 #include "ekjson.h"
 
+// Made with: python3 tools/scripts/genkeys.py keys human name age strength hp
+// percentile > examples/object/keys.h
+#include "keys.h"
+
 typedef struct human {
 	char name[16];
 	int age;
@@ -20,17 +24,23 @@ bool load_human(const char *src, ejtok_t *tokens, human_t *human) {
 		const char *key = src + tokens[i].start;
 		const char *value = src + tokens[i + 1].start;
 
-		if (ejcmp(key, "name")) {
+		switch (human_key(key)) {
+		case HUMAN_NAME:
 			ejstr(value, human->name, sizeof(human->name));
-		} else if (ejcmp(key, "age")) {
+			break;
+		case HUMAN_AGE:
 			human->age = ejint(value);
-		} else if (ejcmp(key, "strength")) {
+			break;
+		case HUMAN_STRENGTH:
 			human->strength = ejint(value);
-		} else if (ejcmp(key, "hp")) {
+			break;
+		case HUMAN_HP:
 			human->hp = ejint(value);
-		} else if (ejcmp(key, "percentile")) {
+			break;
+		case HUMAN_PERCENTILE:
 			human->percentile = ejflt(value);
-		} else {
+			break;
+		default:
 			return false;
 		}
 	}
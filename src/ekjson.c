@@ -7,6 +7,20 @@
 
 #include "ekjson.h"
 
+#if EKJSON_THREADS
+#include <stdlib.h>
+#endif
+
+// The SIMD kernels are built with target attributes and picked with cpuid at
+// runtime, so they need GNU C and x86
+#if !EKJSON_NO_SIMD && defined(__GNUC__) \
+	&& (defined(__x86_64__) || defined(__i386__))
+#define EKJSON_X86 1
+#include <immintrin.h>
+#else
+#define EKJSON_X86 0
+#endif
+
 // Makes a u32 literal out of a list of characters (little endian)
 #define STR2U32(A, B, C, D) ((A) | ((B) << 8) | ((C) << 16) | ((D) << 24))
 #define ARRLEN(A) (sizeof(A) / sizeof((A)[0]))
@@ -16,10 +30,13 @@
 #define EKJSON_ALWAYS_INLINE inline __attribute__((always_inline))
 #define EKJSON_NO_INLINE __attribute__((noinline))
 #define EKJSON_EXPECT(X, Y) __builtin_expect((X), (Y))
+#define EKJSON_TARGET(X) __attribute__((target(X)))
+#define EKJSON_NO_ASAN __attribute__((no_sanitize_address))
 #else
 #define EKJSON_ALWAYS_INLINE
 #define EKJSON_NO_INLINE
 #define EKJSON_EXPECT(X, Y) (X)
+#define EKJSON_NO_ASAN
 #endif
 
 // (except for in space efficient mode)
@@ -84,6 +101,8 @@ static EKJSON_ALWAYS_INLINE void stu64_unaligned(void *const buf,
 	unsigned long long: __builtin_clzll(x), \
 	unsigned long: __builtin_clzl(x), \
 	unsigned int: __builtin_clz(x))
+// Counts the number of set bits
+#define popcnt(x) __builtin_popcountll(x)
 #else // Generic compiler implementations of these bitwise functions
 // Counts the number of trailing zeros in the number (starts from 0th bit)
 static EKJSON_ALWAYS_INLINE uint64_t ctz(uint64_t x) {
@@ -99,6 +118,14 @@ static EKJSON_ALWAYS_INLINE uint64_t ctz(uint64_t x) {
 	n += x & 0xAAAAAAAAAAAAAAAA ? 1 : 0;
 	return n;
 }
+// Counts the number of set bits
+// https://graphics.stanford.edu/~seander/bithacks.html
+static EKJSON_ALWAYS_INLINE uint64_t popcnt(uint64_t x) {
+	x = x - ((x >> 1) & 0x5555555555555555);
+	x = ((x >> 2) & 0x3333333333333333) + (x & 0x3333333333333333);
+	x = ((x >> 4) + x) & 0x0F0F0F0F0F0F0F0F;
+	return (x * 0x0101010101010101) >> 56;
+}
 // Counts the number of leading zeros in the number (starts from 63rd bit)
 static EKJSON_ALWAYS_INLINE uint64_t clz(uint64_t x) {
 	// Set all bits after the most significant set bit too
@@ -106,17 +133,7 @@ static EKJSON_ALWAYS_INLINE uint64_t clz(uint64_t x) {
 	x |= x >> 8, x |= x >> 16, x |= x >> 32;
 	
 	// Flip the bits to get leading zeros
-	x = ~x;
-
-	// Count bits set
-	// https://graphics.stanford.edu/~seander/bithacks.html
-	uint64_t c = x - ((x >> 1) & 0x5555555555555555);
-	c = ((c >> 1) & 0x3333333333333333) + (c & 0x3333333333333333);
-	c = ((c >> 2) + c) & 0x0F0F0F0F0F0F0F0F;
-	c = ((c >> 4) + c) & 0x00FF00FF00FF00FF;
-	c = ((c >> 8) + c) & 0x0000FFFF0000FFFF;
-	c = ((c >> 16) + c) & 0x00000000FFFFFFFF;
-	return c;
+	return popcnt(~x);
 }
 #endif // __GNUC__
 
@@ -212,7 +229,7 @@ static size_t hex2utf8(const char *src, char out[static const 4]) {
 		if (hi > 0xDBFF) return 0;
 
 		// Make sure that there is a \uXXXX after this one
-		if (src[4] != '\\' && src[5] != 'u') return 0;
+		if (src[4] != '\\' || src[5] != 'u') return 0;
 
 		// No need to check for eof since this will be a valid
 		// JSON string by definition of ejparse
@@ -234,6 +251,62 @@ static size_t hex2utf8(const char *src, char out[static const 4]) {
 	}
 }
 
+// Maps all 1-byte escape sequences. Used in escape function, compare func
+// and key hashes
+static const uint8_t unescape[256] = {
+	['"'] = '"', ['\\'] = '\\',
+	['/'] = '/', ['b'] = '\b',
+	['f'] = '\f', ['n'] = '\n',
+	['r'] = '\r', ['t'] = '\t',
+};
+
+// Mixes an 8 byte word into a key hash
+static EKJSON_ALWAYS_INLINE uint64_t hashmix(uint64_t h, const uint64_t w) {
+	h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+	return h ^ h >> 29;
+}
+
+// Hashes the bytes from src to end 8 bytes at a time, unescaping them first
+// if esc is set. Used on keys (without the quotes) and the c strings that
+// ejfind looks for, which hash the same if the keys are equal.
+static EKJSON_INLINE uint64_t hashkey(const char *src, const char *end,
+					const bool esc) {
+	uint64_t h = 0;
+	size_t len = 0;
+
+#if !EKJSON_NO_BITWISE
+	// Go through whole words until the first escape
+	for (; end - src >= 8; src += 8, len += 8) {
+		const uint64_t w = ldu64_unaligned(src);
+		if (esc && hasvalue(w, '\\')) break;
+		h = hashmix(h, w);
+	}
+#endif
+
+	// Then put the rest into words byte by byte
+	uint64_t w = 0;
+	unsigned nw = 0;
+	while (src != end) {
+		char buf[4];
+		size_t n = 1;
+		if (!esc || *src != '\\') {
+			buf[0] = *src++;
+		} else if (*++src == 'u') {
+			n = hex2utf8(++src, buf);
+			src += n == 4 ? 10 : 4;
+		} else {
+			buf[0] = unescape[(uint8_t)*src++];
+		}
+
+		for (size_t i = 0; i < n; i++) {
+			w |= (uint64_t)(uint8_t)buf[i] << nw * 8;
+			if (++nw == 8) h = hashmix(h, w), w = 0, nw = 0;
+		}
+		len += n;
+	}
+	return hashmix(hashmix(h, w), len);
+}
+
 // Used in the slow path of ejflt parser to compare really big ints (> 2^1024)
 typedef struct bigint {
 	uint32_t len;
@@ -500,6 +573,13 @@ typedef struct ejstr_state {
 	size_t len;
 } ejstr_state_t;
 
+// Checks that the document parser can do on top of ejparse's (state.checks)
+enum {
+	CHECK_NUMS = 1 << 0,	// Numbers fit in doubles (ejvalidate)
+	CHECK_STRS = 1 << 1,	// Strings are UTF-8 with valid \u escapes
+	SKIP_FIT = 1 << 2,	// Tokens are thrown away, so don't use toobig
+};
+
 // Main state for the parser (used by most parser functions)
 typedef struct state {
 	// Start of the source code (doesn't change)
@@ -516,8 +596,54 @@ typedef struct state {
 
 	// Next place to allocate a token
 	ejtok_t *t;
+
+	// Where to put the element counts of arrays and objects, if anywhere
+	uint32_t *cnt;
+
+	// Where to put the hashes of keys, if anywhere
+	uint64_t *hash;
+
+	// Where to put the index of the parent of every token, if anywhere
+	uint32_t *par;
+
+	// Checks to do that ejparse leaves for later (see CHECK_NUMS)
+	unsigned checks;
+
+	// Start of the first token that didn't fit in an ejtok_t (see toobig)
+	const char *over;
+
+#if EKJSON_X86
+	// Structural index of the current 64 byte block (see index_sse2)
+	void (*index)(struct state *state);	// Kernel that fills it in
+	const char *blk;	// Start of the block (64 byte aligned)
+	uint64_t ws;		// Whitespace
+	uint64_t stop;		// Chars that end the fast path of a string
+	bool eof;		// Set once the block with the null-terminator is hit
+#endif
 } state_t;
 
+#if EKJSON_X86
+// Entry points of one of the implementations in enum ejimpl
+typedef struct impl {
+	void (*index)(state_t *state);	// NULL to use the scalar parser
+	size_t (*str)(const char *src, char *out, size_t outlen);
+	bool (*cmp)(const char *src, const char *cstr);
+	int64_t (*integer)(const char *src);
+	double (*flt)(const char *src);
+	ejsize_t (*count)(const char *src, const char *end);
+	size_t (*strn)(const char *src, const char *end,
+			char *out, size_t outlen);
+	bool (*cmpn)(const char *src, const char *end, const char *cstr);
+	void (*scan)(const char *src, const char *end, bool esc, bool prevsc,
+			ejpart_t *part);
+	const char *(*skip)(const char *src);
+	bool (*utf8)(const char *src, const char *end, bool *u);
+} impl_t;
+
+// Current implementation (defined with the others at the end of the file)
+static const impl_t *curimpl;
+#endif
+
 // Consumes whitespace and returns a pointer to the first non-whitespace char
 static EKJSON_ALWAYS_INLINE const char *whitespace(const char *src) {
 	for (; *src == ' ' || *src == '\t'
@@ -525,9 +651,24 @@ static EKJSON_ALWAYS_INLINE const char *whitespace(const char *src) {
 	return src;
 }
 
+// Returns whether token i of a document, starting at offset start, is past
+// what an ejtok_t can hold. Its start (or the len of the root) would wrap
+// around without anyone knowing otherwise. Can't happen with EKJSON_LARGE.
+static EKJSON_ALWAYS_INLINE bool toobig(const size_t start, const size_t i) {
+#if EKJSON_LARGE
+	(void)start, (void)i;
+	return false;
+#else
+	return EKJSON_EXPECT(start > UINT32_MAX || i >= (1u << 29) - 1, 0);
+#endif
+}
+
 // Adds a token with the specified type and increments the pointer if there
-// is space
+// is space. Tokens that don't fit make parsing fail at the first one of them
+// (see state->over).
 static EKJSON_INLINE ejtok_t *addtok(state_t *const state, const int type) {
+	if (toobig(state->src - state->base, state->t - state->tbase)
+		&& !state->over) state->over = state->src;
 	*state->t = (ejtok_t){
 		.type = type,
 		.len = 1,
@@ -538,12 +679,188 @@ static EKJSON_INLINE ejtok_t *addtok(state_t *const state, const int type) {
 	return t;
 }
 
-// Parses a string
-// Adds the string token with type 'type'
-// Leaves the source sting at the character after the ending " or after the
-// first error that occurred in the string
-// Returns NULL if error occurred
-static EKJSON_INLINE ejtok_t *string(state_t *const state, const int type) {
+#if EKJSON_X86
+// Saves the classification of the block at state->blk
+static EKJSON_ALWAYS_INLINE void setidx(state_t *const state,
+					uint64_t ws, uint64_t stop,
+					uint64_t nul) {
+	// The first block can start before the source, don't mistake anything
+	// in there for part of it (like a 0 for the null-terminator)
+	if (state->blk < state->base) {
+		const uint64_t in = ~(uint64_t)0 << (state->base - state->blk);
+		ws &= in, stop &= in, nul &= in;
+	}
+
+	// Nothing after the null-terminator is part of it either
+	const uint64_t in = nul ? nul ^ (nul - 1) : ~(uint64_t)0;
+	state->ws = ws & in;
+	state->stop = stop & in;
+	state->eof = nul;
+}
+
+// First stage of the parser. Classifies every byte of the 64 byte block at
+// state->blk, 1 bit per byte (lsb is the first byte), marking whitespace and
+// the chars that end a plain run of string chars ('"', '\\' or control chars,
+// which includes the null-terminator). Since the block is aligned it can never
+// cross a page boundary, so reading before the source or past the
+// null-terminator here is safe. Those bytes are masked off (see setidx), and
+// ASan is told to leave the read alone.
+static EKJSON_NO_INLINE EKJSON_NO_ASAN EKJSON_TARGET("sse2")
+void index_sse2(state_t *const state) {
+	uint64_t ws = 0, stop = 0, nul = 0;
+	for (int i = 0; i < 64; i += 16) {
+		const __m128i x = _mm_load_si128((const __m128i *)
+						(state->blk + i));
+#define EQ(C) _mm_cmpeq_epi8(x, _mm_set1_epi8(C))
+		const __m128i isws = _mm_or_si128(_mm_or_si128(EQ(' '), EQ('\t')),
+						_mm_or_si128(EQ('\r'), EQ('\n')));
+		const __m128i isstop = _mm_or_si128(_mm_or_si128(EQ('"'), EQ('\\')),
+			_mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(0x1F)),
+					_mm_set1_epi8(0x1F)));
+		ws |= (uint64_t)(uint16_t)_mm_movemask_epi8(isws) << i;
+		stop |= (uint64_t)(uint16_t)_mm_movemask_epi8(isstop) << i;
+		nul |= (uint64_t)(uint16_t)_mm_movemask_epi8(EQ(0)) << i;
+#undef EQ
+	}
+	setidx(state, ws, stop, nul);
+}
+
+// Same as index_sse2 but finds whitespace with a lookup by low nibble (' ' =
+// 0x20, '\t' = 0x09, '\n' = 0x0A, '\r' = 0x0D). Bytes with the high bit set
+// always shuffle to 0 so they can't match.
+#define WSTBL ' ', -1, -1, -1, -1, -1, -1, -1, -1, '\t', '\n', -1, -1, '\r', -1, -1
+static EKJSON_NO_INLINE EKJSON_NO_ASAN EKJSON_TARGET("sse4.2")
+void index_sse42(state_t *const state) {
+	const __m128i wstbl = _mm_setr_epi8(WSTBL);
+	const __m128i ctrl = _mm_set1_epi8(0x1F);
+	uint64_t ws = 0, stop = 0, nul = 0;
+	for (int i = 0; i < 64; i += 16) {
+		const __m128i x = _mm_load_si128((const __m128i *)
+						(state->blk + i));
+#define EQ(C) _mm_cmpeq_epi8(x, _mm_set1_epi8(C))
+		const __m128i isws = _mm_cmpeq_epi8(_mm_shuffle_epi8(wstbl, x), x);
+		const __m128i isstop = _mm_or_si128(_mm_or_si128(EQ('"'), EQ('\\')),
+				_mm_cmpeq_epi8(_mm_max_epu8(x, ctrl), ctrl));
+		ws |= (uint64_t)(uint16_t)_mm_movemask_epi8(isws) << i;
+		stop |= (uint64_t)(uint16_t)_mm_movemask_epi8(isstop) << i;
+		nul |= (uint64_t)(uint16_t)_mm_movemask_epi8(EQ(0)) << i;
+#undef EQ
+	}
+	setidx(state, ws, stop, nul);
+}
+
+// Same as index_sse42 in 2 32 byte halves
+static EKJSON_NO_INLINE EKJSON_NO_ASAN EKJSON_TARGET("avx2")
+void index_avx2(state_t *const state) {
+	const __m256i wstbl = _mm256_setr_epi8(WSTBL, WSTBL);
+	const __m256i ctrl = _mm256_set1_epi8(0x1F);
+	uint64_t ws = 0, stop = 0, nul = 0;
+	for (int i = 0; i < 64; i += 32) {
+		const __m256i x = _mm256_load_si256((const __m256i *)
+						(state->blk + i));
+#define EQ(C) _mm256_cmpeq_epi8(x, _mm256_set1_epi8(C))
+		const __m256i isws = _mm256_cmpeq_epi8(
+			_mm256_shuffle_epi8(wstbl, x), x);
+		const __m256i isstop = _mm256_or_si256(
+			_mm256_or_si256(EQ('"'), EQ('\\')),
+			_mm256_cmpeq_epi8(_mm256_max_epu8(x, ctrl), ctrl));
+		ws |= (uint64_t)(uint32_t)_mm256_movemask_epi8(isws) << i;
+		stop |= (uint64_t)(uint32_t)_mm256_movemask_epi8(isstop) << i;
+		nul |= (uint64_t)(uint32_t)_mm256_movemask_epi8(EQ(0)) << i;
+#undef EQ
+	}
+	setidx(state, ws, stop, nul);
+}
+
+// Same as index_sse42 with the whole block at once
+static EKJSON_NO_INLINE EKJSON_NO_ASAN EKJSON_TARGET("avx512bw")
+void index_avx512bw(state_t *const state) {
+	const __m512i wstbl = _mm512_broadcast_i32x4(_mm_setr_epi8(WSTBL));
+	const __m512i x = _mm512_load_si512((const void *)state->blk);
+#define EQ(C) _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8(C))
+	setidx(state,
+		_mm512_cmpeq_epi8_mask(_mm512_shuffle_epi8(wstbl, x), x),
+		EQ('"') | EQ('\\')
+			| _mm512_cmple_epu8_mask(x, _mm512_set1_epi8(0x1F)),
+		EQ(0));
+#undef EQ
+}
+#undef WSTBL
+
+// Starts the index over at the block that src is in
+static void startidx(state_t *const state, const char *const src) {
+	state->blk = (const char *)((uintptr_t)src & ~(uintptr_t)63);
+	state->index(state);
+}
+
+// Moves the index forward to the block that src is in. Returns the offset of
+// src in that block, or 64 if src is past the null-terminator.
+static EKJSON_ALWAYS_INLINE size_t syncidx(state_t *const state,
+					const char *const src) {
+	while ((size_t)(src - state->blk) >= 64) {
+		// Don't read any blocks after the null-terminator
+		if (state->eof) return 64;
+		state->blk += 64;
+		state->index(state);
+	}
+	return src - state->blk;
+}
+
+// Same as whitespace but skips whole runs of whitespace using the index
+static EKJSON_ALWAYS_INLINE const char *whitespace_idx(state_t *const state,
+						const char *src) {
+	if (*src != ' ' && *src != '\t' && *src != '\r' && *src != '\n') {
+		return src;
+	}
+
+	for (;;) {
+		const size_t off = syncidx(state, src);
+		if (off >= 64) return whitespace(src);
+		const uint64_t next = ~state->ws >> off;
+		if (next) return src + ctz(next);
+		src += 64 - off;
+	}
+}
+
+// Skips the string starting at state->src with the index, up until the first
+// '"', '\\' or control char. Returns true if that was the closing quote.
+// Otherwise leaves state->src at the char before it so that the string dfa can
+// take over from there.
+static EKJSON_ALWAYS_INLINE bool string_idx(state_t *const state) {
+	const char *src = state->src + 1;
+	for (;;) {
+		const size_t off = syncidx(state, src);
+		if (off >= 64) return false;
+		const uint64_t next = state->stop >> off;
+		if (next) {
+			src += ctz(next);
+			break;
+		}
+		src += 64 - off;
+	}
+
+	state->src = src;
+	if (*src != '"') {
+		state->src--;
+		return false;
+	}
+	state->src++;
+	return true;
+}
+#endif // EKJSON_X86
+
+// Skips whitespace with either the scalar loop or the structural index
+static EKJSON_ALWAYS_INLINE const char *skipws(state_t *const state,
+						const char *const src,
+						const bool idx) {
+#if EKJSON_X86
+	if (idx) return whitespace_idx(state, src);
+#endif
+	return whitespace(src);
+}
+
+// Runs the string dfa on 1 char, returns the next state
+static EKJSON_ALWAYS_INLINE int strdfa(const int s, const uint8_t c) {
 // Auto-generated by gendfa.py, don't touch, regenerate instead.
 #if EKJSON_SPACE_EFFICENT
 	// Edge table
@@ -626,34 +943,62 @@ static EKJSON_INLINE ejtok_t *string(state_t *const state, const int type) {
 	};
 #endif // EKJSON_SPACE_EFFICENT
 
+#if EKJSON_SPACE_EFFICENT
+	return trans[s][edges[c]];
+#else
+	return trans[s][c];
+#endif
+}
+
 #define STRACCEPT 0
 #define STRFINISHSTATES 6
 #define STRDONE 6
 #define STRERR 7
 
+// Blocks of w bytes can be read with unaligned loads as long as they don't
+// cross into the next page (which might not be mapped)
+static EKJSON_ALWAYS_INLINE bool pagesafe(const char *const p, const size_t w) {
+	return ((uintptr_t)p & 4095) <= 4096 - w;
+}
+
+// Parses a string
+// Adds the string token with type 'type'
+// Leaves the source sting at the character after the ending " or after the
+// first error that occurred in the string
+// Uses the structural index to skip over the string if idx is set
+// Returns NULL if error occurred
+static EKJSON_INLINE ejtok_t *string(state_t *const state, const int type,
+					const bool idx) {
 	// Add the token and save a local copy of the source pointer for speed
 	ejtok_t *const tok = addtok(state, type);
+#if EKJSON_X86
+	if (idx && string_idx(state)) return tok;
+#endif
 	const char *src = state->src + 1;
 
 #if !EKJSON_NO_BITWISE
-	// Eat 8-byte chunks for as long as we can
-	uint64_t probe = ldu64_unaligned(src);
-	while (!(hasless(probe, 0x20)
-		|| hasvalue(probe, '"')
-		|| hasvalue(probe, '\\'))) {
+	// Eat 8-byte chunks for as long as we can. The last few chars of a page
+	// are checked 1 at a time instead, the null-terminator could be right
+	// before the next one.
+	for (;;) {
+		if (!pagesafe(src, 8)) {
+			if ((uint8_t)*src < 0x20 || *src == '"'
+				|| *src == '\\') break;
+			src++;
+			continue;
+		}
+
+		const uint64_t probe = ldu64_unaligned(src);
+		if (hasless(probe, 0x20) || hasvalue(probe, '"')
+			|| hasvalue(probe, '\\')) break;
 		src += 8;
-		probe = ldu64_unaligned(src);
 	}
 #endif
 
 	// Use a dfa to get through things relativly quickly
 	int s = STRACCEPT;
 	do {
-#if EKJSON_SPACE_EFFICENT
-		s = trans[s][edges[(uint8_t)(*src++)]];
-#else
-		s = trans[s][(uint8_t)(*src++)];
-#endif
+		s = strdfa(s, *src++);
 	} while (s < STRFINISHSTATES);
 
 	// Update the normal state source pointer again
@@ -670,11 +1015,8 @@ static EKJSON_INLINE ejtok_t *string(state_t *const state, const int type) {
 	return s == STRDONE ? tok : NULL;
 }
 
-// Parse number
-// Adds token to state variable
-// Leaves state source pointer at the first non-num character
-// Returns NULL if error occurred
-static EKJSON_INLINE ejtok_t *number(state_t *const state) {
+// Runs the number dfa on 1 char, returns the next state
+static EKJSON_ALWAYS_INLINE int numdfa(const int s, const uint8_t c) {
 // Auto-generated by gendfa.py, don't touch, regenerate instead.
 #if EKJSON_SPACE_EFFICENT
 	// Edge table
@@ -854,12 +1196,24 @@ static EKJSON_INLINE ejtok_t *number(state_t *const state) {
 	};
 #endif // EKJSON_SPACE_EFFICENT
 
+#if EKJSON_SPACE_EFFICENT
+	return trans[s][edges[c]];
+#else
+	return trans[s][c];
+#endif
+}
+
 #define NUMACCEPT 0
 #define NUMFINISHSTATES 9
 #define NUMFLTDONE 9
 #define NUMINTDONE 10
 #define NUMERR 11
 
+// Parse number
+// Adds token to state variable
+// Leaves state source pointer at the first non-num character
+// Returns NULL if error occurred
+static EKJSON_INLINE ejtok_t *number(state_t *const state) {
 	// Add token
 	ejtok_t *const tok = addtok(state, EJINT);
 
@@ -871,11 +1225,7 @@ static EKJSON_INLINE ejtok_t *number(state_t *const state) {
 	int s = NUMACCEPT;
 	while (s < NUMFINISHSTATES) {
 		// Get next state using current state
-#if EKJSON_SPACE_EFFICENT
-		s = trans[s][edges[(uint8_t)(*src++)]];
-#else
-		s = trans[s][(uint8_t)(*src++)];
-#endif
+		s = numdfa(s, *src++);
 	}
 
 	// Update token type if it is a float
@@ -937,99 +1287,362 @@ static EKJSON_INLINE ejtok_t *null(state_t *const state) {
 	return (ejtok_t *)((uint64_t)tok & valid);
 }
 
+// What a streaming or resumable parser is in the middle of (ejparser_t.mode)
+enum {
+	FEED_VALUE,	// Whitespace before a value
+	FEED_STR,	// String or key, s is the string dfa state
+	FEED_NUM,	// Number, s is the number dfa state
+	FEED_LIT,	// true/false/null, s is how many chars matched
+	FEED_AFTER,	// Whitespace after a value in an object/array
+	FEED_OBJWS,	// Whitespace before a key or the ending '}'
+	FEED_OBJ,	// A key or the ending '}'
+	FEED_COLON,	// Whitespace and ':' after a key
+	FEED_ARRWS,	// Whitespace before a value or the ending ']'
+	FEED_ARR,	// A value or the ending ']'
+	FEED_END,	// Whitespace after the top-level value
+	FEED_ERR,	// An error occurred, the parser is done
+};
+
+// Returns the first byte of src to end that isn't well-formed UTF-8 (overlong
+// forms, surrogates, code points past U+10FFFF and cut off sequences), or
+// NULL if there are none
+static const char *utf8bad(const char *src, const char *const end) {
+	while (src != end) {
+#if !EKJSON_NO_BITWISE
+		// Skip over ascii 8 bytes at a time
+		if (end - src >= 8
+			&& !(ldu64_unaligned(src) & 0x8080808080808080ull)) {
+			src += 8;
+			continue;
+		}
+#endif
+		const char *const lead = src;
+		const uint8_t c = *src++;
+		if (c < 0x80) continue;
+
+		// The lead byte gives the length and the range of the 2nd byte
+		uint8_t lo = 0x80, hi = 0xBF;
+		size_t n;
+		if (c >= 0xC2 && c <= 0xDF) {
+			n = 1;
+		} else if (c >= 0xE0 && c <= 0xEF) {
+			n = 2;
+			if (c == 0xE0) lo = 0xA0;	// Overlong
+			if (c == 0xED) hi = 0x9F;	// Surrogates
+		} else if (c >= 0xF0 && c <= 0xF4) {
+			n = 3;
+			if (c == 0xF0) lo = 0x90;	// Overlong
+			if (c == 0xF4) hi = 0x8F;	// Past U+10FFFF
+		} else {
+			return lead;
+		}
+
+		if ((size_t)(end - src) < n) return lead;
+		if ((uint8_t)src[0] < lo || (uint8_t)src[0] > hi) return lead;
+		for (size_t i = 1; i < n; i++) {
+			if (((uint8_t)src[i] & 0xC0) != 0x80) return lead;
+		}
+		src += n;
+	}
+	return NULL;
+}
+
+// Returns the first \u escape in src to end that isn't a code point (lone or
+// backwards surrogates), or NULL if there are none. Every backslash has to
+// start an escape, which is the case in a document that ejparse took.
+static const char *escbad(const char *src, const char *const end) {
+	while (src != end) {
+#if !EKJSON_NO_BITWISE
+		if (end - src >= 8 && !hasvalue(ldu64_unaligned(src), '\\')) {
+			src += 8;
+			continue;
+		}
+#endif
+		if (*src++ != '\\') continue;
+		if (*src++ != 'u') continue;
+
+		// The dfa in string() already checked the hex digits
+		char buf[4];
+		const size_t n = hex2utf8(src, buf);
+		if (!n) return src - 2;
+		src += n == 4 ? 10 : 4;
+	}
+	return NULL;
+}
+
+#if EKJSON_X86
+// Scalar version of the utf8 entry point in impl_t (which only uses u to skip
+// escbad when there are no \u escapes)
+static bool utf8_scalar(const char *src, const char *end, bool *u) {
+	*u = true;
+	return !utf8bad(src, end);
+}
+
+// Error bits of the UTF-8 lookup tables (from Keiser and Lemire's "Validating
+// UTF-8 In Less Than One Instruction Per Byte"). Every table is looked up by
+// a nibble of the last 2 bytes and a byte is only bad if the bits that all 3
+// give back have something in common.
+#define U8SHORT		0x01	// Lead byte without enough continuations
+#define U8LONG		0x02	// Continuation without a lead byte
+#define U8OVER3		0x04	// Overlong 3 byte sequence
+#define U8LARGE		0x08	// Past U+10FFFF
+#define U8SURR		0x10	// Surrogate (U+D800 to U+DFFF)
+#define U8OVER2		0x20	// Overlong 2 byte sequence
+#define U8OVER4		0x40	// Overlong 4 byte sequence (or F4 9x)
+#define U8TWOCONT	0x80	// 2 continuations in a row
+#define U8CARRY		(U8SHORT | U8LONG | U8TWOCONT)
+
+// High nibble of the byte before
+#define U8HI1 \
+	U8LONG, U8LONG, U8LONG, U8LONG, U8LONG, U8LONG, U8LONG, U8LONG, \
+	U8TWOCONT, U8TWOCONT, U8TWOCONT, U8TWOCONT, \
+	U8SHORT | U8OVER2, U8SHORT, U8SHORT | U8OVER3 | U8SURR, \
+	U8SHORT | U8LARGE | U8OVER4
+// Low nibble of the byte before
+#define U8LO1 \
+	U8CARRY | U8OVER3 | U8OVER2 | U8OVER4, U8CARRY | U8OVER2, \
+	U8CARRY, U8CARRY, U8CARRY | U8LARGE, \
+	U8CARRY | U8LARGE | U8OVER4, U8CARRY | U8LARGE | U8OVER4, \
+	U8CARRY | U8LARGE | U8OVER4, U8CARRY | U8LARGE | U8OVER4, \
+	U8CARRY | U8LARGE | U8OVER4, U8CARRY | U8LARGE | U8OVER4, \
+	U8CARRY | U8LARGE | U8OVER4, U8CARRY | U8LARGE | U8OVER4, \
+	U8CARRY | U8LARGE | U8OVER4 | U8SURR, \
+	U8CARRY | U8LARGE | U8OVER4, U8CARRY | U8LARGE | U8OVER4
+// High nibble of the byte itself
+#define U8HI2 \
+	U8SHORT, U8SHORT, U8SHORT, U8SHORT, \
+	U8SHORT, U8SHORT, U8SHORT, U8SHORT, \
+	U8LONG | U8OVER2 | U8TWOCONT | U8OVER3 | U8OVER4, \
+	U8LONG | U8OVER2 | U8TWOCONT | U8OVER3 | U8LARGE, \
+	U8LONG | U8OVER2 | U8TWOCONT | U8SURR | U8LARGE, \
+	U8LONG | U8OVER2 | U8TWOCONT | U8SURR | U8LARGE, \
+	U8SHORT, U8SHORT, U8SHORT, U8SHORT
+
+// Ors the bytes of 'in' that are bad UTF-8 into err, prev is the block before
+// it. Also ors the backslashes that come right before a 'u' into u.
+static inline EKJSON_TARGET("sse4.2") void utf8blk_sse42(const __m128i in,
+							const __m128i prev,
+							__m128i *const err,
+							__m128i *const u) {
+	const __m128i lo4 = _mm_set1_epi8(0x0F);
+	const __m128i prev1 = _mm_alignr_epi8(in, prev, 15);
+	*u = _mm_or_si128(*u, _mm_and_si128(
+		_mm_cmpeq_epi8(prev1, _mm_set1_epi8('\\')),
+		_mm_cmpeq_epi8(in, _mm_set1_epi8('u'))));
+
+	// All ascii, only a sequence cut off at the end of prev is wrong
+	if (!_mm_movemask_epi8(in)) {
+		*err = _mm_or_si128(*err, _mm_subs_epu8(prev, _mm_setr_epi8(
+			-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+			0xEF, 0xDF, 0xBF)));
+		return;
+	}
+
+	const __m128i sc = _mm_and_si128(_mm_and_si128(
+		_mm_shuffle_epi8(_mm_setr_epi8(U8HI1),
+			_mm_and_si128(_mm_srli_epi16(prev1, 4), lo4)),
+		_mm_shuffle_epi8(_mm_setr_epi8(U8LO1),
+			_mm_and_si128(prev1, lo4))),
+		_mm_shuffle_epi8(_mm_setr_epi8(U8HI2),
+			_mm_and_si128(_mm_srli_epi16(in, 4), lo4)));
+
+	// 3rd and 4th bytes of a sequence have to be continuations
+	const __m128i must23 = _mm_or_si128(
+		_mm_subs_epu8(_mm_alignr_epi8(in, prev, 14),
+			_mm_set1_epi8(0x60)),
+		_mm_subs_epu8(_mm_alignr_epi8(in, prev, 13),
+			_mm_set1_epi8(0x70)));
+	*err = _mm_or_si128(*err, _mm_xor_si128(_mm_and_si128(must23,
+		_mm_set1_epi8(0x80)), sc));
+}
+
+// Validates UTF-8 16 bytes at a time
+static EKJSON_TARGET("sse4.2") bool utf8_sse42(const char *src,
+						const char *const end,
+						bool *const u) {
+	__m128i prev = _mm_setzero_si128(), err = _mm_setzero_si128();
+	__m128i us = _mm_setzero_si128();
+	for (; end - src >= 16; src += 16) {
+		const __m128i in = _mm_loadu_si128((const __m128i *)src);
+		utf8blk_sse42(in, prev, &err, &us);
+		prev = in;
+	}
+
+	// Zeros after the end catch sequences that got cut off
+	char buf[16] = {0};
+	for (size_t i = 0; src + i != end; i++) buf[i] = src[i];
+	const __m128i in = _mm_loadu_si128((const __m128i *)buf);
+	utf8blk_sse42(in, prev, &err, &us);
+	*u = !_mm_testz_si128(us, us);
+	return _mm_testz_si128(err, err);
+}
+
+// Same as utf8blk_sse42 but 32 bytes at a time
+static inline EKJSON_TARGET("avx2") void utf8blk_avx2(const __m256i in,
+							const __m256i prev,
+							__m256i *const err,
+							__m256i *const u) {
+	const __m256i lo4 = _mm256_set1_epi8(0x0F);
+	const __m256i cross = _mm256_permute2x128_si256(prev, in, 0x21);
+	const __m256i prev1 = _mm256_alignr_epi8(in, cross, 15);
+	*u = _mm256_or_si256(*u, _mm256_and_si256(
+		_mm256_cmpeq_epi8(prev1, _mm256_set1_epi8('\\')),
+		_mm256_cmpeq_epi8(in, _mm256_set1_epi8('u'))));
+
+	if (!_mm256_movemask_epi8(in)) {
+		*err = _mm256_or_si256(*err, _mm256_subs_epu8(prev,
+			_mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+				-1, -1, -1, -1, -1, -1, -1, -1,
+				-1, -1, -1, -1, -1, -1, -1, -1,
+				-1, -1, -1, -1, -1, 0xEF, 0xDF, 0xBF)));
+		return;
+	}
+
+	const __m256i sc = _mm256_and_si256(_mm256_and_si256(
+		_mm256_shuffle_epi8(_mm256_setr_epi8(U8HI1, U8HI1),
+			_mm256_and_si256(_mm256_srli_epi16(prev1, 4), lo4)),
+		_mm256_shuffle_epi8(_mm256_setr_epi8(U8LO1, U8LO1),
+			_mm256_and_si256(prev1, lo4))),
+		_mm256_shuffle_epi8(_mm256_setr_epi8(U8HI2, U8HI2),
+			_mm256_and_si256(_mm256_srli_epi16(in, 4), lo4)));
+
+	const __m256i must23 = _mm256_or_si256(
+		_mm256_subs_epu8(_mm256_alignr_epi8(in, cross, 14),
+			_mm256_set1_epi8(0x60)),
+		_mm256_subs_epu8(_mm256_alignr_epi8(in, cross, 13),
+			_mm256_set1_epi8(0x70)));
+	*err = _mm256_or_si256(*err, _mm256_xor_si256(_mm256_and_si256(must23,
+		_mm256_set1_epi8(0x80)), sc));
+}
+
+// Validates UTF-8 32 bytes at a time
+static EKJSON_TARGET("avx2") bool utf8_avx2(const char *src,
+						const char *const end,
+						bool *const u) {
+	__m256i prev = _mm256_setzero_si256(), err = _mm256_setzero_si256();
+	__m256i us = _mm256_setzero_si256();
+	for (; end - src >= 32; src += 32) {
+		const __m256i in = _mm256_loadu_si256((const __m256i *)src);
+		utf8blk_avx2(in, prev, &err, &us);
+		prev = in;
+	}
+
+	char buf[32] = {0};
+	for (size_t i = 0; src + i != end; i++) buf[i] = src[i];
+	const __m256i in = _mm256_loadu_si256((const __m256i *)buf);
+	utf8blk_avx2(in, prev, &err, &us);
+	*u = !_mm256_testz_si256(us, us);
+	return _mm256_testz_si256(err, err);
+}
+#endif // EKJSON_X86
+
+// Returns the first place in a document that ejparse took (src to end) where
+// a string isn't valid (see CHECK_STRS), or NULL if they're all valid. Every
+// byte outside of strings is ascii, so the whole document can be checked at
+// once instead of string by string.
+static const char *strictdoc(const char *const src, const char *const end) {
+#if EKJSON_X86
+	bool u;
+	if (!curimpl->utf8(src, end, &u)) return utf8bad(src, end);
+	return u ? escbad(src, end) : NULL;
+#else
+	const char *const bad = utf8bad(src, end);
+	return bad ? bad : escbad(src, end);
+#endif
+}
+
+// Checks that the number that was just parsed at src fits in a double
+// The token's start isn't used since it can be cut off past 4GB (see SKIP_FIT)
+static bool checknum(const char *const src) {
+	// Out of range numbers end up as +/-inf or nan
+	const double x = ejflt(src);
+	return x - x == 0.0;
+}
+
 // Main heartbeat of the ekjson parser
 // This will parse anything in a json document
-// Takes in a depth parameter to make sure that no stack overflows can occur
-static ejtok_t *value(state_t *const state, const int depth) {
-	// The token that we are parsing (also the value)
-	ejtok_t *tok = NULL;
+// Objects and arrays are parsed without recursion by keeping the containers
+// that are still open on 'stack', so the nesting is only limited by nstack
+// If idx is set, whitespace and strings are skipped with the structural index
+// If p is set, parsing picks up where p left off and stops before the token
+// buffer can overflow, saving where it was in p (p->mode is FEED_ERR if it
+// stopped for any other reason)
+// If side is set, the element counts, key hashes and parents are put into
+// state->cnt, state->hash and state->par (when they aren't NULL), and numbers
+// are checked with checknum if CHECK_NUMS is in state->checks
+// Returns false if an error occurred or it stopped
+static EKJSON_ALWAYS_INLINE bool document(state_t *const state,
+					ejframe_t *const stack,
+					const size_t nstack,
+					const bool idx,
+					ejparser_t *const p,
+					const bool side) {
+	// Number of open objects/arrays (the depth of the next value)
+	size_t depth = 0;
+
+	// Innermost open object/array (see ejframe_t)
+	ejframe_t *f = NULL;
+
+	// The token that we just parsed (also the value) and its key
+	ejtok_t *tok, *key;
+
+	// Where the number that is being parsed starts (see checknum)
+	const char *num;
+
+	// Go back to where we stopped
+	if (p) {
+		const int mode = p->mode;
+		p->mode = FEED_ERR;
+		if ((depth = p->depth)) f = stack + depth - 1;
+		if (mode == FEED_OBJ) goto object;
+	}
 
-	// Check if we are over the callstack limit
-	if (depth >= EKJSON_MAX_DEPTH) return NULL;
+value:
+	// Check if we are over the stack limit
+	if (depth >= nstack) return false;
 
 	// Eat whitespace first as per spec
-	state->src = whitespace(state->src);
+	state->src = skipws(state, state->src, idx);
+
+	// Stop here if there is no room for the token
+	if (p && state->t == state->tend) {
+		p->mode = FEED_VALUE;
+		goto full;
+	}
 
 	// Figure out what kind of value/token we are going to parse
 	switch (*state->src) {
 	case '{':
-		// Parse an object, add the token first
+		// Parse an object, add the token first and open it
 		tok = addtok(state, EJOBJ);
+		f = stack + depth++;
+		f->tok = (size_t)(tok - state->tbase) << 1 | 1;
+		if (side && state->cnt) state->cnt[tok - state->tbase] = 0;
 
 		// Parse whitespace after initial '{'
-		state->src = whitespace(state->src + 1);
-
-		// Make sure we're not at the ending '}' already
-		// If not then actually parse a key and value
-		while (*state->src != '}') {
-			// Get the key eg. "a"
-			ejtok_t *const key = string(state, EJKV);
-
-			// If the key had errors, exit now
-			if (!key) return NULL;
-
-			// Do an early check for : since most documents
-			// have the : right after the key with no whitespace
-			// (this is a situational optimization but doesn't
-			//  hurt in terms of performance if the assumption is
-			//  incorrect)
-			if (*state->src != ':') {
-				// Parse the whitespace after the key
-				state->src = whitespace(state->src);
-				if (*state->src++ != ':') return NULL;
-			} else {
-				state->src++;
-			}
-
-			// Now take the value. No need to parse whitespace
-			// since values already do that initially
-			const ejtok_t *const val = value(state, depth + 1);
-
-			// If the value had errors, exit now
-			if (!val) return NULL;
-
-			// Update the key and object length
-			key->len += val->len;
-			tok->len += val->len + 1;
- 			if (*state->src == ',') {
-				// Make sure to parse whitespace for next key
-				// and also skip the ','
-				state->src = whitespace(state->src + 1);
-			}
-		}
-
-		state->src++;	// Eat last '}' character
-		break;
+		state->src = skipws(state, state->src + 1, idx);
+		goto object;
 	case '[':
-		// Parse an array, create the array token first
+		// Parse an array, create the array token first and open it
 		tok = addtok(state, EJARR);
+		f = stack + depth++;
+		f->tok = (size_t)(tok - state->tbase) << 1;
+		if (side && state->cnt) state->cnt[tok - state->tbase] = 0;
 
 		// Parse the whitespace after the initial '['
-		state->src = whitespace(state->src + 1);
-
-		// Make sure we're not at the ending ']' already
-		// If not then actually parse a key and value
-		while (*state->src != ']') {
-			// Parse array value (does whitespace before and after)
-			const ejtok_t *const val = value(state, depth + 1);
-
-			// About out right now if the value had an error
-			if (!val) return NULL;
-			tok->len += val->len;	// Update array length
-
-			// Eat the ',' (no whitespace parsing needed,
-			// value does it)
-			if (*state->src == ',') state->src++;
-		}
-
-		state->src++;	// Eat the last ']'
-		break;
+		state->src = skipws(state, state->src + 1, idx);
+		goto array;
 	case '"':		// Parse and create string token
-		tok = string(state, EJSTR);
+		tok = string(state, EJSTR, idx);
 		break;
 	case '-': case '0': case '1': case '2': case '3': case '4':
 	case '5': case '6': case '7': case '8': case '9':	// Number token
+		num = state->src;
 		tok = number(state);
+
+		// Do the check that would only happen in ejflt otherwise
+		if (side && state->checks & CHECK_NUMS && tok
+			&& !checknum(num)) return false;
 		break;
 	case 't': case 'f':	// Parse and create boolean token
 		tok = boolean(state);
@@ -1038,31 +1651,191 @@ static ejtok_t *value(state_t *const state, const int depth) {
 		tok = null(state);
 		break;
 	case '\0':		// Parse '\0', error if not on top-level
-		if (depth) return NULL;
-		else return (void *)1;
-		break;
+		return !depth;
 	default:		// If its anything else, its an error
-		return NULL;
+		return false;
 	}
 
+close:
 	// Parse final whitespace (like json spec)
-	state->src = whitespace(state->src);
-	return tok;
+	state->src = skipws(state, state->src, idx);
+
+	// If the value had errors, exit now
+	if (!tok) return false;
+
+	// Done if this was the top-level value
+	if (!depth) {
+		if (side && state->par) state->par[0] = UINT32_MAX;
+		return true;
+	}
+
+	// Keys are right before their values, unless the buffer is full and
+	// they both went on the last token
+	key = tok - (tok != state->tend);
+
+	// Values in objects hang off of their keys. Containers get here once
+	// they're closed, which is when f is their parent again.
+	if (side && state->par) {
+		state->par[tok - state->tbase] = f->tok & 1
+			? (size_t)(key - state->tbase) : f->tok >> 1;
+	}
+
+	if (side && state->cnt) state->cnt[f->tok >> 1]++;
+	if (f->tok & 1) {
+		// Update the key and object length
+		key->len += tok->len;
+		state->tbase[f->tok >> 1].len += tok->len + 1;
+		if (*state->src == ',') {
+			// Make sure to parse whitespace for next key
+			// and also skip the ','
+			state->src = skipws(state, state->src + 1, idx);
+		}
+	} else {
+		state->tbase[f->tok >> 1].len += tok->len; // Array length
+
+		// Eat the ',' (no whitespace parsing needed, value does it)
+		if (*state->src == ',') state->src++;
+		goto array;
+	}
+
+object:
+	// Make sure we're not at the ending '}' already
+	// If not then actually parse a key and value
+	if (*state->src == '}') goto pop;
+
+	// Stop here if there is no room for the key
+	if (p && state->t == state->tend) {
+		p->mode = FEED_OBJ;
+		goto full;
+	}
+
+	// Get the key eg. "a"
+	key = string(state, EJKV, idx);
+
+	// If the key had errors, exit now
+	if (!key) return false;
+
+	// Hash the key while it's still in the cache
+	if (side && state->hash) {
+		state->hash[key - state->tbase] = hashkey(state->base
+			+ key->start + 1, state->src - 1, true);
+	}
+	if (side && state->par) state->par[key - state->tbase] = f->tok >> 1;
+
+	// Do an early check for : since most documents have the : right
+	// after the key with no whitespace (this is a situational optimization
+	// but doesn't hurt in terms of performance if the assumption is
+	// incorrect)
+	if (*state->src != ':') {
+		// Parse the whitespace after the key
+		state->src = skipws(state, state->src, idx);
+		if (*state->src++ != ':') return false;
+	} else {
+		state->src++;
+	}
+
+	// Now take the value. No need to parse whitespace since values
+	// already do that initially
+	goto value;
+
+array:
+	// Make sure we're not at the ending ']' already
+	// If not then parse the next value (does whitespace before and after)
+	if (*state->src != ']') goto value;
+
+pop:
+	// Eat the last '}' or ']' and close the object/array
+	state->src++;
+	tok = state->tbase + (f->tok >> 1);
+	f = --depth ? f - 1 : NULL;
+	goto close;
+
+full:
+	p->depth = depth;
+	return false;
+}
+
+// Document parsers used by ejparse
+static EKJSON_NO_INLINE bool parse(state_t *const state,
+				ejframe_t *const stack,
+				const size_t nstack) {
+	return document(state, stack, nstack, false, NULL, false);
+}
+#if EKJSON_X86
+static EKJSON_NO_INLINE bool parse_idx(state_t *const state,
+				ejframe_t *const stack,
+				const size_t nstack) {
+	return document(state, stack, nstack, true, NULL, false);
+}
+#endif
+
+// Document parsers used by ejparse_counts, ejparse_hashes, ejparse_parents
+// and ejvalidate
+static EKJSON_NO_INLINE bool parse_x(state_t *const state,
+				ejframe_t *const stack,
+				const size_t nstack) {
+	return document(state, stack, nstack, false, NULL, true);
+}
+#if EKJSON_X86
+static EKJSON_NO_INLINE bool parse_x_idx(state_t *const state,
+					ejframe_t *const stack,
+					const size_t nstack) {
+	return document(state, stack, nstack, true, NULL, true);
+}
+#endif
+
+// Resumable document parsers used by ejparse_resume, ejparse_many and
+// ejsplit_parse
+static EKJSON_NO_INLINE bool parse_r(state_t *const state,
+				ejparser_t *const p) {
+	return document(state, p->stack, p->nstack, false, p, false);
+}
+#if EKJSON_X86
+static EKJSON_NO_INLINE bool parse_r_idx(state_t *const state,
+					ejparser_t *const p) {
+	return document(state, p->stack, p->nstack, true, p, false);
 }
+#endif
 
-// This is just a wrapper around the value parser
+// This is just a wrapper around the document parser
 // It just initializes the state and checks for error states
-ejresult_t ejparse(const char *src, ejtok_t *t, size_t nt) {
+static ejresult_t deep(const char *src, ejtok_t *t, size_t nt, uint32_t *cnt,
+			uint64_t *hash, uint32_t *par, unsigned checks,
+			ejframe_t *stack, size_t nstack) {
 	// Create initial state. Set end to 1 minus the end since the functions
 	// in ejparse will overwrite at most 1 over the buffer given to it.
 	// This is done because its faster. :/
 	state_t state = {
 		.base = src, .src = src,
 		.tbase = t, .tend = t + nt - 1, .t = t,
+		.cnt = cnt, .hash = hash, .par = par, .checks = checks,
 	};
 
+	// Only pay for the side outputs when they're used
+	const bool side = cnt || hash || par || checks & CHECK_NUMS;
+
+#if EKJSON_X86
+	// If the implementation has an index, index the first block and let
+	// the second stage build the tokens
+	bool value_result;
+	if ((state.index = curimpl->index)) {
+		startidx(&state, src);
+		value_result = side ? parse_x_idx(&state, stack, nstack)
+			: parse_idx(&state, stack, nstack);
+	} else {
+		value_result = side ? parse_x(&state, stack, nstack)
+			: parse(&state, stack, nstack);
+	}
+#else
 	// See if the value parsed correctly
-	const bool value_result = value(&state, 0);
+	bool value_result = side ? parse_x(&state, stack, nstack)
+		: parse(&state, stack, nstack);
+#endif
+
+	// A token that didn't fit is an error right where it starts
+	if (state.over && !(checks & SKIP_FIT)) {
+		value_result = false, state.src = state.over;
+	}
 
 	// BAD CODE WARNING (jk)
 	// So since the error location is returned after an error occured the
@@ -1076,9 +1849,14 @@ ejresult_t ejparse(const char *src, ejtok_t *t, size_t nt) {
 		state.src--;			// Fix the fuckup
 	}
 
-	const bool okay = value_result	 // Was there a parsing error?
-		&& state.t != state.tend // Did we take up all memory?
-		&& *state.src == '\0';	 // Make sure we ended at end of string
+	const bool done = value_result	// Was there a parsing error?
+		&& *state.src == '\0';	// Make sure we ended at end of string
+
+	// Strings are checked after the whole document is parsed
+	const char *const bad = done && checks & CHECK_STRS
+		? strictdoc(src, state.src) : NULL;
+	const bool okay = done && !bad
+		&& state.t != state.tend; // Did we take up all memory?
 
 	// Return ejresult_t value
 	return okay ? (ejresult_t){
@@ -1087,33 +1865,1283 @@ ejresult_t ejparse(const char *src, ejtok_t *t, size_t nt) {
 		.ntoks = 0,
 	} : (ejresult_t){
 		.err = true,
-		.loc = state.src,
+		.full = done && !bad,
+		.loc = bad ? bad : state.src,
 		.ntoks = state.t - state.tbase,
 	};
 }
 
-// Maps all 1-byte escape sequences. Used in escape function and compare func
-static const uint8_t unescape[256] = {
-	['"'] = '"', ['\\'] = '\\',
-	['/'] = '/', ['b'] = '\b',
-	['f'] = '\f', ['n'] = '\n',
-	['r'] = '\r', ['t'] = '\t',
-};
-
-// Returns whether or not the escape charcter is valid (usually is)
-// Updates state with the newly escaped character
-static bool escape(ejstr_state_t *state) {
-	// Check if its a normal escape charater
-	if (*++state->src != 'u') {
-		// Write out the byte if we can
-		if (state->out < state->end) {
-			// Use escapes table to map to unescaped char
-			*state->out++ = unescape[*state->src];
-		}
+ejresult_t ejparse_deep(const char *src, ejtok_t *t, size_t nt,
+			ejframe_t *stack, size_t nstack) {
+	return deep(src, t, nt, NULL, NULL, NULL, 0, stack, nstack);
+}
 
-		// Increment src ptr, len and exit early
-		++state->src, ++state->len;
-		return true;
+// Parses with a stack of EKJSON_MAX_DEPTH frames on the callstack
+ejresult_t ejparse(const char *src, ejtok_t *t, size_t nt) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	return deep(src, t, nt, NULL, NULL, NULL, 0, stack, ARRLEN(stack));
+}
+ejresult_t ejparse_counts(const char *src, ejtok_t *t, size_t nt,
+			uint32_t *counts) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	return deep(src, t, nt, counts, NULL, NULL, 0, stack, ARRLEN(stack));
+}
+ejresult_t ejparse_hashes(const char *src, ejtok_t *t, size_t nt,
+			uint64_t *hashes) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	return deep(src, t, nt, NULL, hashes, NULL, 0, stack, ARRLEN(stack));
+}
+ejresult_t ejparse_parents(const char *src, ejtok_t *t, size_t nt,
+			uint32_t *parents) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	return deep(src, t, nt, NULL, NULL, parents, 0, stack, ARRLEN(stack));
+}
+ejresult_t ejparse_strict(const char *src, ejtok_t *t, size_t nt) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	return deep(src, t, nt, NULL, NULL, NULL, CHECK_STRS,
+			stack, ARRLEN(stack));
+}
+
+// Every token after the first one goes in the second one of these, so the
+// buffer is always full at the end of a document with any tokens in it. None
+// of them are kept, so documents of any size are fine.
+ejresult_t ejvalidate(const char *src, bool check) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	ejtok_t t[2];
+	const ejresult_t res = deep(src, t, 2, NULL, NULL, NULL,
+				check ? CHECK_NUMS | CHECK_STRS | SKIP_FIT
+				: SKIP_FIT, stack, ARRLEN(stack));
+	return !res.err || res.full ? (ejresult_t){ .err = false }
+		: (ejresult_t){ .err = true, .loc = res.loc };
+}
+
+size_t ejelems(const ejtok_t *arr, uint32_t *idx, size_t nidx) {
+	size_t n = 0;
+	for (size_t i = 1; i < arr->len; i += arr[i].len, n++) {
+		if (n >= nidx) continue;
+		if (i > UINT32_MAX) return SIZE_MAX;
+		idx[n] = i;
+	}
+	return n;
+}
+
+// Same as ejparse_deep but keeps its state in p so that it can stop when the
+// token buffer is full and pick back up after ejparser_grow
+ejresult_t ejparse_resume(ejparser_t *p, const char *src) {
+	state_t state = {
+		.base = src, .src = src + p->pos,
+		.tbase = p->tbase, .tend = p->tend, .t = p->t,
+	};
+
+	// Only the places that the document parser can stop at are okay
+	if (p->mode != FEED_VALUE && p->mode != FEED_OBJ) {
+		p->mode = FEED_ERR;
+		return (ejresult_t){
+			.err = true,
+			.loc = state.src,
+			.ntoks = state.t - state.tbase,
+		};
+	}
+
+#if EKJSON_X86
+	// Index the block we are starting in (see ejparse_deep)
+	bool value_result;
+	if ((state.index = curimpl->index)) {
+		startidx(&state, state.src);
+		value_result = parse_r_idx(&state, p);
+	} else {
+		value_result = parse_r(&state, p);
+	}
+#else
+	bool value_result = parse_r(&state, p);
+#endif
+	p->t = state.t;
+	if (state.over) {
+		value_result = false, state.src = state.over;
+		p->mode = FEED_ERR;
+	}
+
+	// Stopped because the token buffer is full
+	if (!value_result && p->mode != FEED_ERR) {
+		p->pos = state.src - src;
+		return (ejresult_t){
+			.err = true,
+			.full = true,
+			.loc = state.src,
+			.ntoks = state.t - state.tbase,
+		};
+	}
+
+	// Fix the src pointer after string errors (see ejparse_deep)
+	if (!value_result && state.src > state.base
+		&& state.src[-1] == '\0') {
+		state.src--;
+	}
+
+	const bool okay = value_result && *state.src == '\0';
+	p->mode = okay ? FEED_END : FEED_ERR;
+	p->pos = state.src - src;
+	return (ejresult_t){
+		.err = !okay,
+		.loc = okay ? NULL : state.src,
+		.ntoks = state.t - state.tbase,
+	};
+}
+
+// Parses the documents one after another with the resumable parser so that
+// a full token buffer stops right before the document that didn't fit. The
+// offsets are from base, and only documents that start before stop are
+// parsed if it isn't NULL.
+static ejmany_t many(const char *base, const char *src, const char *stop,
+			ejtok_t *t, size_t nt, ejdoc_t *docs, size_t ndocs) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	ejparser_t p = { .stack = stack, .nstack = ARRLEN(stack) };
+	state_t state = {
+		.base = base, .src = whitespace(src),
+		.tbase = t, .tend = t + nt, .t = t,
+	};
+	const char *next = NULL;
+	size_t n = 0;
+
+#if EKJSON_X86
+	// Index the first block (see ejparse_deep)
+	if ((state.index = curimpl->index)) {
+		startidx(&state, state.src);
+	}
+#endif
+
+	for (; *state.src && (!stop || state.src < stop);
+		state.src = whitespace(state.src)) {
+		const char *const start = state.src;
+		ejtok_t *const tok = state.t;
+		if (n == ndocs) {
+			next = start;
+			break;
+		}
+
+		p.mode = FEED_VALUE, p.depth = 0;
+#if EKJSON_X86
+		bool value_result = state.index ? parse_r_idx(&state, &p)
+			: parse_r(&state, &p);
+#else
+		bool value_result = parse_r(&state, &p);
+#endif
+		if (state.over) {
+			value_result = false, state.src = state.over;
+			p.mode = FEED_ERR, state.over = NULL;
+		}
+
+		// Stopped because the token buffer is full
+		if (!value_result && p.mode != FEED_ERR) {
+			state.t = tok;
+			next = start;
+			break;
+		}
+
+		// Nothing else can be on the line after the document
+		const char *end = state.src;
+		if (value_result) {
+			bool eol = !*end;
+			for (; end[-1] == ' ' || end[-1] == '\t'
+				|| end[-1] == '\r' || end[-1] == '\n'; end--) {
+				eol |= end[-1] == '\n';
+			}
+			if (eol) {
+				docs[n++] = (ejdoc_t){
+					.start = start - base, .end = end - base,
+					.tok = tok - t, .ntoks = state.t - tok,
+					.err = false, .loc = NULL,
+				};
+				continue;
+			}
+		}
+
+		// Fix the src pointer after string errors (see ejparse_deep)
+		if (state.src > start && state.src[-1] == '\0') {
+			state.src--;
+		}
+
+		// Drop the tokens and go on from the line after the one that the
+		// document started on (strings with errors can go past the end
+		// of their line)
+		for (end = start; *end && *end != '\n'; end++);
+		docs[n++] = (ejdoc_t){
+			.start = start - base, .end = end - base,
+			.tok = tok - t, .ntoks = 0,
+			.err = true, .loc = state.src,
+		};
+		state.t = tok;
+		state.src = end;
+#if EKJSON_X86
+		// The error could have been before the indexed block
+		if (state.index) {
+			state.eof = false;
+			startidx(&state, state.src);
+		}
+#endif
+	}
+
+	return (ejmany_t){
+		.ndocs = n,
+		.ntoks = state.t - t,
+		.next = next,
+	};
+}
+ejmany_t ejparse_many(const char *src, ejtok_t *t, size_t nt,
+			ejdoc_t *docs, size_t ndocs) {
+	return many(src, src, NULL, t, nt, docs, ndocs);
+}
+
+#if EKJSON_THREADS
+// Parses the shard into its arenas, growing them whenever they run out
+static void poolwork(ejpool_t *pool, size_t i) {
+	ejshard_t *const s = pool->shards + i;
+	const char *src = pool->src + pool->cuts[i];
+	const char *const stop = pool->src + pool->cuts[i + 1];
+	s->src = src, s->ndocs = s->ntoks = 0, s->oom = false;
+
+	while (true) {
+		const ejmany_t r = many(s->src, src, stop, s->t + s->ntoks,
+			s->tcap - s->ntoks, s->docs + s->ndocs,
+			s->dcap - s->ndocs);
+
+		// Make the new documents point into the whole token buffer
+		for (ejdoc_t *d = s->docs + s->ndocs;
+			d != s->docs + s->ndocs + r.ndocs; d++) {
+			d->tok += s->ntoks;
+		}
+		s->ndocs += r.ndocs, s->ntoks += r.ntoks;
+		if (!r.next) return;
+		src = r.next;
+
+		// Start out at about a token every 8 chars and then double
+		void *p;
+		if (s->ndocs == s->dcap) {
+			const size_t cap = s->dcap ? s->dcap * 2
+				: (size_t)(stop - src) / 64 + 16;
+			if (!(p = realloc(s->docs, cap * sizeof(*s->docs)))) {
+				break;
+			}
+			s->docs = p, s->dcap = cap;
+		} else {
+			const size_t cap = s->tcap ? s->tcap * 2
+				: (size_t)(stop - src) / 8 + 64;
+			if (!(p = realloc(s->t, cap * sizeof(*s->t)))) break;
+			s->t = p, s->tcap = cap;
+		}
+	}
+	s->oom = true;
+}
+
+// Waits for batches from ejpool_many and parses its shard of them
+static void *poolthread(void *arg) {
+	ejpool_t *const pool = arg;
+	uint64_t gen = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	const size_t i = pool->nstarted++;
+	while (true) {
+		while (pool->gen == gen && !pool->quit) {
+			pthread_cond_wait(&pool->go, &pool->lock);
+		}
+		if (pool->quit) break;
+		gen = pool->gen;
+
+		pthread_mutex_unlock(&pool->lock);
+		poolwork(pool, i);
+		pthread_mutex_lock(&pool->lock);
+		if (!--pool->left) pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+bool ejpool_init(ejpool_t *pool, size_t nthreads) {
+	if (!nthreads) nthreads = 1;
+	if (nthreads > EKJSON_MAX_THREADS) nthreads = EKJSON_MAX_THREADS;
+	*pool = (ejpool_t){ .nthreads = 1, .nstarted = 1 };
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->go, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	// The thread calling ejpool_many parses the first shard itself
+	for (; pool->nthreads < nthreads; pool->nthreads++) {
+		if (pthread_create(pool->threads + pool->nthreads, NULL,
+				poolthread, pool)) {
+			ejpool_free(pool);
+			return false;
+		}
+	}
+	return true;
+}
+
+void ejpool_free(ejpool_t *pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->go);
+	pthread_mutex_unlock(&pool->lock);
+	for (size_t i = 1; i < pool->nthreads; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	for (size_t i = 0; i < pool->nthreads; i++) {
+		free(pool->shards[i].t);
+		free(pool->shards[i].docs);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->go);
+	pthread_cond_destroy(&pool->done);
+	*pool = (ejpool_t){0};
+}
+
+bool ejpool_many(ejpool_t *pool, const char *src, size_t len) {
+	// Every shard starts at the line after the one its even share starts
+	// in, so that each line is parsed by exactly one thread
+	const size_t n = pool->nthreads;
+	pool->cuts[0] = 0, pool->cuts[n] = len;
+	for (size_t i = 1; i < n; i++) {
+		size_t c = len / n * i + len % n * i / n;
+		for (c = c ? c - 1 : 0; c < len && src[c] != '\n'; c++);
+		c = c < len ? c + 1 : len;
+		pool->cuts[i] = c < pool->cuts[i - 1] ? pool->cuts[i - 1] : c;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->src = src;
+	pool->left = n - 1;
+	pool->gen++;
+	pthread_cond_broadcast(&pool->go);
+	pthread_mutex_unlock(&pool->lock);
+
+	poolwork(pool, 0);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->left) pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+
+	bool okay = true;
+	for (size_t i = 0; i < n; i++) okay &= !pool->shards[i].oom;
+	return okay;
+}
+#endif
+
+void ejparser_grow(ejparser_t *p, ejtok_t *t, size_t nt) {
+	// Move every pointer into the old buffer over to the new one (the
+	// frames only have indices)
+	if (p->tok) p->tok = t + (p->tok - p->tbase);
+	p->t = t + (p->t - p->tbase);
+	p->tbase = t, p->tend = t + nt;
+}
+
+// Same as whitespace but stops at the end of the chunk
+static EKJSON_ALWAYS_INLINE const char *whitespace_n(const char *src,
+						const char *const end) {
+	for (; src != end && (*src == ' ' || *src == '\t'
+		|| *src == '\r' || *src == '\n'); src++);
+	return src;
+}
+
+// Same as addtok but for the streaming parser. There has to be space left
+static EKJSON_INLINE ejtok_t *addtok_feed(ejparser_t *const p, const int type,
+					const size_t start) {
+	*p->t = (ejtok_t){
+		.type = type,
+		.len = 1,
+		.start = start,
+	};
+	return p->t++;
+}
+
+void ejparser_init(ejparser_t *p, ejtok_t *t, size_t nt,
+		ejframe_t *stack, size_t nstack) {
+	*p = (ejparser_t){
+		.tbase = t, .tend = t + nt, .t = t,
+		.stack = stack, .nstack = nstack,
+		.mode = FEED_VALUE,
+	};
+}
+
+// Works just like document() except that every part of it can stop at the
+// end of a chunk and pick back up in the next one (see ejparser_t.mode)
+ejresult_t ejfeed(ejparser_t *p, const char *chunk, size_t len) {
+	const char *src = chunk, *const end = chunk + len;
+	const bool eof = !len;
+	ejframe_t *f = p->depth ? p->stack + p->depth - 1 : NULL;
+	ejtok_t *tok;
+	int s = p->s;
+
+	for (;;) switch (p->mode) {
+	case FEED_VALUE:
+		// Check if we are over the stack limit
+		if (p->depth >= p->nstack) goto err;
+		if ((src = whitespace_n(src, end)) == end) {
+			// The end of the input is only okay on the top-level
+			if (eof && p->depth) goto err;
+			if (eof) p->mode = FEED_END;
+			goto out;
+		}
+
+		// Stop here if there is no room for the token
+		if (p->t == p->tend) goto full;
+		if (toobig(p->pos + (src - chunk), p->t - p->tbase)) goto err;
+
+		// Figure out what kind of value/token we are going to parse
+		switch (*src) {
+		case '{': case '[':
+			// Add the object/array token and open it
+			tok = addtok_feed(p, *src == '{' ? EJOBJ : EJARR,
+					p->pos + (src - chunk));
+			f = p->stack + p->depth++;
+			f->tok = (size_t)(tok - p->tbase) << 1 | (*src == '{');
+			p->mode = *src++ == '{' ? FEED_OBJWS : FEED_ARRWS;
+			continue;
+		case '"':
+			p->tok = addtok_feed(p, EJSTR, p->pos + (src - chunk));
+			p->mode = FEED_STR, s = STRACCEPT, src++;
+			break;
+		case '-': case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			p->tok = addtok_feed(p, EJINT, p->pos + (src - chunk));
+			p->mode = FEED_NUM, s = NUMACCEPT;
+			break;
+		case 't': case 'f': case 'n':
+			p->tok = addtok_feed(p, *src == 'n' ? EJNULL : EJBOOL,
+					p->pos + (src - chunk));
+			p->lit = *src == 't' ? "true"
+				: *src == 'f' ? "false" : "null";
+			p->mode = FEED_LIT, s = 0;
+			break;
+		default:		// If its anything else, its an error
+			goto err;
+		}
+		continue;
+	case FEED_STR:
+#if !EKJSON_NO_BITWISE
+		// Eat 8-byte chunks for as long as we can (and have them)
+		while (s == STRACCEPT && end - src >= 8) {
+			const uint64_t probe = ldu64_unaligned(src);
+			if (hasless(probe, 0x20) || hasvalue(probe, '"')
+				|| hasvalue(probe, '\\')) break;
+			src += 8;
+		}
+#endif
+		while (src != end && (s = strdfa(s, *src++)) < STRFINISHSTATES);
+		if (s < STRFINISHSTATES) {
+			// Strings can't be cut off by the end of the input
+			if (eof) goto err;
+			goto out;
+		}
+		if (s != STRDONE) goto err;
+
+		// Keys are followed by their value, the rest end a value
+		if (p->tok->type == EJKV) {
+			p->mode = FEED_COLON;
+			continue;
+		}
+		tok = p->tok;
+		goto close;
+	case FEED_NUM:
+		// Stop at the first non-num character without eating it
+		for (; src != end; src++) {
+			if ((s = numdfa(s, *src)) >= NUMFINISHSTATES) break;
+		}
+
+		// The null-terminator ends the number just like in ejparse
+		if (src == end) {
+			if (!eof) goto out;
+			s = numdfa(s, '\0');
+		}
+		if (s == NUMERR) goto err;
+
+		// Update token type if it is a float
+		p->tok->type = s == NUMFLTDONE ? EJFLT : p->tok->type;
+		tok = p->tok;
+		goto close;
+	case FEED_LIT:
+		// Match the rest of 'true'/'false'/'null'
+		for (; src != end && p->lit[s]; src++, s++) {
+			if (*src != p->lit[s]) goto err;
+		}
+		if (p->lit[s]) {
+			if (eof) goto err;
+			goto out;
+		}
+		tok = p->tok;
+		goto close;
+	case FEED_AFTER:
+		if ((src = whitespace_n(src, end)) == end) {
+			if (eof) goto err;
+			goto out;
+		}
+		if (f->tok & 1) {
+			// Make sure to parse whitespace for next key and also
+			// skip the ','
+			if (*src == ',') p->mode = FEED_OBJWS, src++;
+			else p->mode = FEED_OBJ;
+		} else {
+			// Eat the ',' (no whitespace parsing needed, value
+			// does it)
+			if (*src == ',') src++;
+			p->mode = FEED_ARR;
+		}
+		continue;
+	case FEED_OBJWS:
+		// Stay here if the whitespace goes to the end of the chunk
+		if ((src = whitespace_n(src, end)) == end) {
+			if (eof) goto err;
+			goto out;
+		}
+		p->mode = FEED_OBJ;
+		// Fall through
+	case FEED_OBJ:
+		if (src == end) {
+			if (eof) goto err;
+			goto out;
+		}
+
+		// Make sure we're not at the ending '}' already
+		if (*src == '}') goto pop;
+
+		// Stop here if there is no room for the key
+		if (p->t == p->tend) goto full;
+		if (toobig(p->pos + (src - chunk), p->t - p->tbase)) goto err;
+
+		// Start the key, its first char is skipped just like string()
+		p->tok = addtok_feed(p, EJKV, p->pos + (src - chunk));
+		p->mode = FEED_STR, s = STRACCEPT, src++;
+		continue;
+	case FEED_COLON:
+		if ((src = whitespace_n(src, end)) == end) {
+			if (eof) goto err;
+			goto out;
+		}
+		if (*src++ != ':') goto err;
+		p->mode = FEED_VALUE;
+		continue;
+	case FEED_ARRWS:
+		// Stay here if the whitespace goes to the end of the chunk
+		if ((src = whitespace_n(src, end)) == end) {
+			if (eof) goto err;
+			goto out;
+		}
+		p->mode = FEED_ARR;
+		// Fall through
+	case FEED_ARR:
+		if (src == end) {
+			if (eof) goto err;
+			goto out;
+		}
+
+		// Make sure we're not at the ending ']' already
+		if (*src == ']') goto pop;
+		p->mode = FEED_VALUE;
+		continue;
+	case FEED_END:
+		// Make sure that only whitespace is after the document
+		if ((src = whitespace_n(src, end)) != end) goto err;
+		goto out;
+	default:
+		goto err;
+	pop:
+		// Eat the last '}' or ']' and close the object/array
+		src++;
+		tok = p->tbase + (f->tok >> 1);
+		f = --p->depth ? f - 1 : NULL;
+	close:
+		// Done if this was the top-level value
+		if (!f) {
+			p->mode = FEED_END;
+			continue;
+		}
+
+		if (f->tok & 1) {
+			// Update the key (right before the value) and object
+			// length
+			tok[-1].len += tok->len;
+			p->tbase[f->tok >> 1].len += tok->len + 1;
+		} else {
+			p->tbase[f->tok >> 1].len += tok->len; // Array length
+		}
+		p->mode = FEED_AFTER;
+		continue;
+	}
+
+out:
+	p->s = s;
+	p->pos += len;
+	return (ejresult_t){
+		.err = false,
+		.loc = NULL,
+		.ntoks = p->t - p->tbase,
+	};
+full:
+	// The rest of the chunk can be fed again after ejparser_grow
+	p->pos += src - chunk;
+	return (ejresult_t){
+		.err = true,
+		.full = true,
+		.loc = src,
+		.ntoks = p->t - p->tbase,
+	};
+err:
+	p->mode = FEED_ERR;
+	p->pos += src - chunk;
+	return (ejresult_t){
+		.err = true,
+		.loc = src,
+		.ntoks = p->t - p->tbase,
+	};
+}
+
+// The streaming parser never reads outside of the chunk it is given, so
+// inputs that aren't null-terminated are just 1 big chunk
+ejresult_t ejparse_deep_n(const char *src, size_t len, ejtok_t *t, size_t nt,
+			ejframe_t *stack, size_t nstack) {
+	ejparser_t p;
+	ejparser_init(&p, t, nt, stack, nstack);
+	if (len) {
+		const ejresult_t res = ejfeed(&p, src, len);
+		if (res.err) return res;
+	}
+	return ejfeed(&p, src + len, 0);
+}
+ejresult_t ejparse_n(const char *src, size_t len, ejtok_t *t, size_t nt) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	return ejparse_deep_n(src, len, t, nt, stack, ARRLEN(stack));
+}
+
+// Reads the char at src, or the null-terminator if the input ends there
+static EKJSON_ALWAYS_INLINE char peek(const char *const src,
+				const char *const end) {
+	return end && src == end ? '\0' : *src;
+}
+
+// Skips the string at src without validating it, returning the char after the
+// closing quote (or the end of the input if there isn't one)
+static EKJSON_ALWAYS_INLINE const char *skipstr(const char *src,
+						const char *const end) {
+	for (src++;; src++) {
+#if !EKJSON_NO_BITWISE
+		// Eat 8-byte chunks for as long as we can, then go straight to the
+		// first '"', '\\' or control char (the lowest byte these find is
+		// always exact). Without an end they stay in the page like in
+		// string().
+		while (end ? end - src >= 8 : pagesafe(src, 8)) {
+			const uint64_t probe = ldu64_unaligned(src);
+			const uint64_t stop = hasless(probe, 0x20)
+				| hasvalue(probe, '"') | hasvalue(probe, '\\');
+			if (stop) {
+				src += ctz(stop) / 8;
+				break;
+			}
+			src += 8;
+		}
+#endif
+		const char c = peek(src, end);
+		if (c == '"') return src + 1;
+		if (c == '\0') return src;
+		if (c == '\\' && peek(++src, end) == '\0') return src;
+	}
+}
+
+// Skips the rest of a number or literal
+static EKJSON_ALWAYS_INLINE const char *skipscalar(const char *src,
+						const char *const end) {
+	for (;; src++) switch (peek(src, end)) {
+	case ' ': case '\t': case '\r': case '\n': case ',': case ':':
+	case '{': case '}': case '[': case ']': case '"': case '\0':
+		return src;
+	}
+}
+
+// Counts the tokens one value at a time. Each string, number and literal is
+// 1 token, as is each object and array (keys are just strings). The input
+// ends at the null-terminator or end if it isn't NULL.
+static EKJSON_ALWAYS_INLINE ejsize_t countvals(const char *src,
+						const char *const end) {
+	ejsize_t n = { .ntoks = 0, .depth = 0 };
+	size_t depth = 0;
+	for (;; src++) switch (peek(src = whitespace_n(src, end), end)) {
+	case ',': case ':':
+		break;
+	case '{': case '[':
+		n.ntoks++;
+		if (++depth > n.depth) n.depth = depth;
+		break;
+	case '}': case ']':
+		depth -= depth != 0;
+		break;
+	case '"':
+		n.ntoks++;
+		src = skipstr(src, end) - 1;
+		break;
+	case '\0':
+		return n;
+	default:
+		n.ntoks++;
+		src = skipscalar(src + 1, end) - 1;
+		break;
+	}
+}
+static EKJSON_NO_INLINE ejsize_t count_scalar(const char *src,
+					const char *const end) {
+	return end ? countvals(src, end) : countvals(src, NULL);
+}
+
+#if EKJSON_X86
+// Chars in a 64 byte block that ejcount cares about, 1 bit per byte
+typedef struct cntidx {
+	uint64_t qt;	// '"'
+	uint64_t bs;	// '\\'
+	uint64_t open;	// '{' and '['
+	uint64_t close;	// '}' and ']'
+	uint64_t sep;	// Whitespace, ',' and ':'
+	uint64_t nul;	// Null-terminator
+} cntidx_t;
+
+// Classifies a block for ejcount. '[' and ']' are 0x20 away from '{' and '}'
+// so setting that bit finds both at once. The whole block is read, see cntblk.
+static inline EKJSON_NO_ASAN EKJSON_TARGET("sse2")
+void cntblk_sse2(const char *const blk, cntidx_t *const idx) {
+	*idx = (cntidx_t){ 0 };
+	for (int i = 0; i < 64; i += 16) {
+		const __m128i x = _mm_load_si128((const __m128i *)(blk + i));
+		const __m128i lo = _mm_or_si128(x, _mm_set1_epi8(0x20));
+#define EQ(X, C) _mm_cmpeq_epi8(X, _mm_set1_epi8(C))
+#define MASK(V) ((uint64_t)(uint16_t)_mm_movemask_epi8(V) << i)
+		const __m128i sep = _mm_or_si128(
+			_mm_or_si128(_mm_or_si128(EQ(x, ' '), EQ(x, '\t')),
+				_mm_or_si128(EQ(x, '\r'), EQ(x, '\n'))),
+			_mm_or_si128(EQ(x, ','), EQ(x, ':')));
+		idx->qt |= MASK(EQ(x, '"'));
+		idx->bs |= MASK(EQ(x, '\\'));
+		idx->open |= MASK(EQ(lo, '{'));
+		idx->close |= MASK(EQ(lo, '}'));
+		idx->sep |= MASK(sep);
+		idx->nul |= MASK(EQ(x, 0));
+#undef MASK
+#undef EQ
+	}
+}
+
+// Same as cntblk_sse2 in 2 32 byte halves
+static inline EKJSON_NO_ASAN EKJSON_TARGET("avx2")
+void cntblk_avx2(const char *const blk, cntidx_t *const idx) {
+	*idx = (cntidx_t){ 0 };
+	for (int i = 0; i < 64; i += 32) {
+		const __m256i x = _mm256_load_si256((const __m256i *)(blk + i));
+		const __m256i lo = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+#define EQ(X, C) _mm256_cmpeq_epi8(X, _mm256_set1_epi8(C))
+#define MASK(V) ((uint64_t)(uint32_t)_mm256_movemask_epi8(V) << i)
+		const __m256i sep = _mm256_or_si256(
+			_mm256_or_si256(
+				_mm256_or_si256(EQ(x, ' '), EQ(x, '\t')),
+				_mm256_or_si256(EQ(x, '\r'), EQ(x, '\n'))),
+			_mm256_or_si256(EQ(x, ','), EQ(x, ':')));
+		idx->qt |= MASK(EQ(x, '"'));
+		idx->bs |= MASK(EQ(x, '\\'));
+		idx->open |= MASK(EQ(lo, '{'));
+		idx->close |= MASK(EQ(lo, '}'));
+		idx->sep |= MASK(sep);
+		idx->nul |= MASK(EQ(x, 0));
+#undef MASK
+#undef EQ
+	}
+}
+
+// Same as cntblk_sse2 with the whole block at once
+static inline EKJSON_NO_ASAN EKJSON_TARGET("avx512bw")
+void cntblk_avx512bw(const char *const blk, cntidx_t *const idx) {
+	const __m512i x = _mm512_load_si512((const void *)blk);
+	const __m512i lo = _mm512_or_si512(x, _mm512_set1_epi8(0x20));
+#define EQ(X, C) _mm512_cmpeq_epi8_mask(X, _mm512_set1_epi8(C))
+	*idx = (cntidx_t){
+		.qt = EQ(x, '"'),
+		.bs = EQ(x, '\\'),
+		.open = EQ(lo, '{'),
+		.close = EQ(lo, '}'),
+		.sep = EQ(x, ' ') | EQ(x, '\t') | EQ(x, '\r') | EQ(x, '\n')
+			| EQ(x, ',') | EQ(x, ':'),
+		.nul = EQ(x, 0),
+	};
+#undef EQ
+}
+
+// Classifies the block at blk with the kernel for impl. The block is read in
+// place even when it starts before the document or goes past its end, which
+// can't fault since it's aligned (see index_sse2). Callers mask those off.
+static EKJSON_ALWAYS_INLINE void cntblk(const char *const blk,
+					cntidx_t *const idx,
+					const enum ejimpl impl) {
+	switch (impl) {
+	case EJIMPL_AVX512BW: cntblk_avx512bw(blk, idx); break;
+	case EJIMPL_AVX2: cntblk_avx2(blk, idx); break;
+	default: cntblk_sse2(blk, idx); break;
+	}
+}
+
+// Marks the chars escaped by a backslash. Runs of backslashes escape every
+// other one, so a run escapes the char after it when its odd length. esc is
+// whether the first char of the next block is escaped. (from simdjson)
+static EKJSON_ALWAYS_INLINE uint64_t escaped(uint64_t bs, uint64_t *const esc) {
+	const uint64_t even = 0x5555555555555555ull;
+	bs &= ~*esc;
+	const uint64_t follows = bs << 1 | *esc;
+	const uint64_t oddstarts = bs & ~even & ~follows;
+	const uint64_t evenseqs = oddstarts + bs;
+	*esc = evenseqs < bs;
+	return (even ^ evenseqs << 1) & follows;
+}
+
+// Sets every bit from an opening quote up to (not including) its closing one
+static EKJSON_ALWAYS_INLINE uint64_t prefixxor(uint64_t x) {
+	x ^= x << 1, x ^= x << 2, x ^= x << 4;
+	x ^= x << 8, x ^= x << 16, x ^= x << 32;
+	return x;
+}
+
+// Counts the tokens a block at a time. Tokens are the opening quotes, the
+// '{' and '[' outside of strings and the first char of each run of number or
+// literal chars (anything that isn't structural, a separator or a quote).
+// Same as countvals, the input ends at the null-terminator or end.
+static EKJSON_ALWAYS_INLINE ejsize_t countblks(const char *const src,
+						const char *const end,
+						const enum ejimpl impl) {
+	const char *blk = (const char *)((uintptr_t)src & ~(uintptr_t)63);
+	uint64_t valid = ~0ull << (src - blk);
+	uint64_t esc = 0, instr = 0, prevsc = 0;
+	ejsize_t n = { .ntoks = 0, .depth = 0 };
+	int64_t depth = 0;
+
+	for (;; blk += 64, valid = ~0ull) {
+		// Only the chars before the end count
+		if (end && blk >= end) return n;
+		if (end && end - blk < 64) valid &= (1ull << (end - blk)) - 1;
+
+		cntidx_t idx;
+		cntblk(blk, &idx, impl);
+
+		// Nothing past the null-terminator is part of the document
+		const uint64_t nul = idx.nul & valid;
+		if (nul) valid &= (nul & -nul) - 1;
+
+		const uint64_t qt = idx.qt & valid & ~escaped(idx.bs & valid, &esc);
+		const uint64_t str = prefixxor(qt) ^ instr;
+		instr = (uint64_t)((int64_t)str >> 63);
+
+		const uint64_t open = idx.open & valid & ~str;
+		const uint64_t close = idx.close & valid & ~str;
+		const uint64_t sc = ~(idx.qt | idx.open | idx.close | idx.sep)
+			& valid & ~str;
+		n.ntoks += popcnt(qt & str) + popcnt(open)
+			+ popcnt(sc & ~(sc << 1 | prevsc));
+		prevsc = sc >> 63;
+
+		// Only have to go through them in order if this block could go
+		// deeper than the deepest so far
+		if (depth + (int64_t)popcnt(open) > (int64_t)n.depth) {
+			for (uint64_t b = open | close; b; b &= b - 1) {
+				depth += open & b & -b ? 1 : -1;
+				if (depth > (int64_t)n.depth) n.depth = depth;
+			}
+		} else {
+			depth += popcnt(open) - popcnt(close);
+		}
+		depth = depth < 0 ? 0 : depth;
+
+		if (nul || (end && end - blk <= 64)) return n;
+	}
+}
+
+// Returns the char after the object or array at src, or NULL if the document
+// ends first. Goes a block at a time with the same classifiers as ejcount,
+// only looking at the brackets one by one in the block where it ends.
+static EKJSON_ALWAYS_INLINE const char *skipblks(const char *const src,
+						const enum ejimpl impl) {
+	const char *blk = (const char *)((uintptr_t)src & ~(uintptr_t)63);
+	uint64_t valid = ~0ull << (src - blk);
+	uint64_t esc = 0, instr = 0;
+	int64_t depth = 0;
+
+	for (;; blk += 64, valid = ~0ull) {
+		cntidx_t idx;
+		cntblk(blk, &idx, impl);
+
+		const uint64_t nul = idx.nul & valid;
+		if (nul) valid &= (nul & -nul) - 1;
+
+		const uint64_t qt = idx.qt & valid & ~escaped(idx.bs & valid, &esc);
+		const uint64_t str = prefixxor(qt) ^ instr;
+		instr = (uint64_t)((int64_t)str >> 63);
+
+		const uint64_t open = idx.open & valid & ~str;
+		const uint64_t close = idx.close & valid & ~str;
+		if (depth - (int64_t)popcnt(close) <= 0) {
+			for (uint64_t b = open | close; b; b &= b - 1) {
+				if (open & b & -b) depth++;
+				else if (!--depth) return blk + ctz(b) + 1;
+			}
+		} else {
+			depth += popcnt(open) - popcnt(close);
+		}
+
+		if (nul) return NULL;
+	}
+}
+#endif // EKJSON_X86
+
+ejsize_t ejcount(const char *src) {
+#if EKJSON_X86
+	return curimpl->count(src, NULL);
+#else
+	return count_scalar(src, NULL);
+#endif
+}
+ejsize_t ejcount_n(const char *src, size_t len) {
+#if EKJSON_X86
+	return curimpl->count(src, src + len);
+#else
+	return count_scalar(src, src + len);
+#endif
+}
+
+// Running totals of ejsplit_scan. Everything is counted as if the chunk
+// started outside of a string, and also in total, since starting inside of
+// one just swaps what is and isn't in a string. The tokens are the same ones
+// that countblks counts.
+typedef struct scan {
+	bool instr;		// In a string
+	bool esc;		// Next char is escaped
+	bool prevsc;		// Last char was a number or literal char
+	size_t nqt;		// Unescaped quotes
+	size_t ntoks, all;	// Tokens outside of strings and in total
+	int64_t depth, alldepth;// Same for the depth
+} scan_t;
+
+// Adds 1 char to the totals, the same way that countblks would
+static EKJSON_ALWAYS_INLINE void scanchar(scan_t *const s, const char c) {
+	bool sc = false, tok = false;
+	int64_t depth = 0;
+	switch (c) {
+	case ' ': case '\t': case '\r': case '\n': case ',': case ':':
+		break;
+	case '"':
+		if (s->esc) break;
+		s->instr = !s->instr, s->nqt++;
+		s->all++, s->ntoks += s->instr;
+		break;
+	case '{': case '[':
+		depth = 1, tok = true;
+		break;
+	case '}': case ']':
+		depth = -1;
+		break;
+	default:
+		sc = true, tok = !s->prevsc;
+		break;
+	}
+	s->esc = !s->esc && c == '\\';
+	s->prevsc = sc;
+	s->all += tok, s->alldepth += depth;
+	if (!s->instr) s->ntoks += tok, s->depth += depth;
+}
+
+// Scans src up to end one char at a time
+static EKJSON_ALWAYS_INLINE void scanchars(scan_t *const s, const char *src,
+					const char *const end) {
+	for (; src != end; src++) scanchar(s, *src);
+}
+
+// Saves the totals of a chunk in its part
+static void scansave(const scan_t *const s, ejpart_t *const part) {
+	part->ntoks[0] = s->ntoks, part->ntoks[1] = s->all - s->ntoks;
+	part->depth[0] = s->depth, part->depth[1] = s->alldepth - s->depth;
+	part->flip = s->nqt & 1;
+}
+
+static EKJSON_NO_INLINE void scan_scalar(const char *src, const char *end,
+					bool esc, bool prevsc,
+					ejpart_t *part) {
+	scan_t s = { .esc = esc, .prevsc = prevsc };
+	scanchars(&s, src, end);
+	scansave(&s, part);
+}
+
+#if EKJSON_X86
+// Same as scan_scalar but a block at a time with the ejcount kernels after
+// getting to the first aligned block
+static EKJSON_ALWAYS_INLINE void scanblks(const char *src,
+					const char *const end,
+					const bool esc, const bool prevsc,
+					ejpart_t *const part,
+					const enum ejimpl impl) {
+	scan_t s = { .esc = esc, .prevsc = prevsc };
+	const size_t head = -(uintptr_t)src & 63;
+	const char *blk = (size_t)(end - src) > head ? src + head : end;
+	scanchars(&s, src, blk);
+
+	uint64_t bsc = s.esc, instr = 0, prev = s.prevsc;
+	int64_t nqt = 0, ntoks = 0, all = 0, depth = 0, alldepth = 0;
+	for (; blk < end; blk += 64) {
+		// Only the chars before the end count
+		const uint64_t valid = end - blk < 64
+			? (1ull << (end - blk)) - 1 : ~0ull;
+
+		cntidx_t idx;
+		cntblk(blk, &idx, impl);
+
+		const uint64_t qt = idx.qt & valid
+			& ~escaped(idx.bs & valid, &bsc);
+		const uint64_t str = prefixxor(qt) ^ instr;
+		instr = (uint64_t)((int64_t)str >> 63);
+
+		const uint64_t open = idx.open & valid;
+		const uint64_t close = idx.close & valid;
+		const uint64_t sc = ~(idx.qt | idx.open | idx.close | idx.sep)
+			& valid;
+		const uint64_t tok = open | (sc & ~(sc << 1 | prev));
+		prev = sc >> 63;
+
+		nqt += popcnt(qt);
+		ntoks += popcnt(qt & str) + popcnt(tok & ~str);
+		all += popcnt(qt) + popcnt(tok);
+		depth += popcnt(open & ~str) - popcnt(close & ~str);
+		alldepth += popcnt(open) - popcnt(close);
+	}
+
+	// Starting inside of a string swaps what the blocks count
+	if (s.instr) ntoks = all - ntoks, depth = alldepth - depth;
+	s.nqt += nqt, s.ntoks += ntoks, s.all += all;
+	s.depth += depth, s.alldepth += alldepth;
+	scansave(&s, part);
+}
+#endif // EKJSON_X86
+
+// Start of the i'th of n even chunks of a document
+static const char *chunkat(const char *const src, const size_t len,
+			const size_t n, const size_t i) {
+	return src + len / n * i + len % n * i / n;
+}
+
+// Whether the char at src is escaped by the backslashes before it
+static bool isescaped(const char *const base, const char *src) {
+	bool esc = false;
+	for (; src != base && src[-1] == '\\'; src--) esc = !esc;
+	return esc;
+}
+
+// Whether the char before src is the char of a number or literal
+static bool isscalar(const char *const base, const char *const src) {
+	if (src == base) return false;
+	switch (src[-1]) {
+	case ' ': case '\t': case '\r': case '\n': case ',': case ':':
+	case '{': case '}': case '[': case ']': case '"':
+		return false;
+	default:
+		return true;
+	}
+}
+
+void ejsplit_scan(const char *src, size_t len, ejpart_t *parts, size_t nparts,
+		size_t i) {
+	const char *const begin = chunkat(src, len, nparts, i);
+	const char *const end = chunkat(src, len, nparts, i + 1);
+	const bool esc = isescaped(src, begin), prevsc = isscalar(src, begin);
+#if EKJSON_X86
+	curimpl->scan(begin, end, esc, prevsc, parts + i);
+#else
+	scan_scalar(begin, end, esc, prevsc, parts + i);
+#endif
+}
+
+// Where a part of a split array starts
+typedef struct split {
+	const char *src;	// After the ',' before it, NULL if empty
+	size_t tok;		// Index of its first token
+} split_t;
+
+// Finds where the i'th part starts by adding up the chunks before it, then
+// going to the first ',' of the top-level array in its chunk. If the array
+// ends before that, the part is empty and starts after the last token.
+static split_t splitat(const char *const src, const size_t len,
+			const ejpart_t *const parts, const size_t nparts,
+			const size_t i) {
+	const char *begin = chunkat(src, len, nparts, i);
+	const char *const end = src + len;
+	bool instr = false;
+	int64_t depth = 0;
+	size_t tok = 0;
+	for (size_t j = 0; j < i; j++) {
+		tok += parts[j].ntoks[instr];
+		depth += parts[j].depth[instr];
+		instr ^= parts[j].flip;
+	}
+
+	scan_t s = {
+		.instr = instr,
+		.esc = isescaped(src, begin),
+		.prevsc = isscalar(src, begin),
+	};
+	for (; begin != end; begin++) {
+		scanchar(&s, *begin);
+		if (s.instr) continue;
+		if (*begin == ',' && depth + s.depth == 1) {
+			return (split_t){
+				.src = begin + 1,
+				.tok = tok + s.ntoks,
+			};
+		}
+
+		// The array ended
+		if ((*begin == ']' || *begin == '}') && depth + s.depth <= 0) {
+			break;
+		}
+	}
+	return (split_t){ .src = NULL, .tok = tok + s.ntoks };
+}
+
+ejresult_t ejsplit_parse(const char *src, size_t len, ejtok_t *t, size_t nt,
+			ejpart_t *parts, size_t nparts, size_t i) {
+	ejpart_t *const part = parts + i;
+	const bool isarr = *whitespace(src) == '[';
+	part->len = 0;
+	part->res = (ejresult_t){ .err = false, .loc = NULL, .ntoks = 0 };
+	if (i && !isarr) return part->res;
+
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	split_t from = { .src = src, .tok = 0 }, to = { .src = NULL };
+	if (i) from = splitat(src, len, parts, nparts, i);
+	if (!from.src) return part->res;
+	if (isarr) to = splitat(src, len, parts, nparts, i + 1);
+	if (isarr && from.src == to.src) return part->res;
+	if (!isarr) to.tok = nt;
+	if (to.tok > nt) {
+		part->res = (ejresult_t){
+			.err = true, .full = true, .loc = from.src,
+		};
+		return part->res;
+	}
+
+	// The elements of the array are parsed one at a time as top-level
+	// values, so they get a frame less to make up for the array
+	ejparser_t p = {
+		.tbase = t + from.tok, .tend = t + to.tok, .t = t + from.tok,
+		.stack = stack, .nstack = ARRLEN(stack) - isarr,
+	};
+	state_t state = {
+		.base = src, .src = from.src,
+		.tbase = p.tbase, .tend = p.tend, .t = p.t,
+	};
+	const char *const stop = to.src ? to.src - 1 : NULL;
+#if EKJSON_X86
+	// Index the block we are starting in (see ejparse_deep)
+	if ((state.index = curimpl->index)) {
+		startidx(&state, state.src);
+	}
+#endif
+
+	// The first part opens the array itself (or is the whole document)
+	bool value_result = true, cut = false;
+	if (!i && isarr) {
+		state.src = whitespace(state.src);
+		if ((value_result = state.t != state.tend)) {
+			addtok(&state, EJARR);
+			state.src = whitespace(state.src + 1);
+		}
+	}
+
+	size_t elems = 0;
+	while (value_result) {
+		// The ',' are eaten just like in document()
+		if (isarr && *state.src == ']') {
+			state.src = whitespace(state.src + 1);
+			break;
+		}
+
+		ejtok_t *const tok = state.t;
+		p.mode = FEED_VALUE, p.depth = 0;
+#if EKJSON_X86
+		value_result = state.index ? parse_r_idx(&state, &p)
+			: parse_r(&state, &p);
+#else
+		value_result = parse_r(&state, &p);
+#endif
+		if (!isarr) break;
+
+		// Only the top-level can end at the null-terminator
+		if (!value_result || state.t == tok) {
+			value_result = false;
+			break;
+		}
+		elems += tok->len;
+
+		// Stop at the end of this part
+		if (*state.src == ',') {
+			cut = stop && state.src >= stop;
+			state.src++;
+			if (cut) break;
+		}
+	}
+	if (state.over) value_result = false, state.src = state.over;
+
+	// Fix the src pointer after string errors (see ejparse_deep)
+	if (!value_result && state.src > state.base
+		&& state.src[-1] == '\0') {
+		state.src--;
+	}
+
+	// Has to have ended right where the next part starts, with exactly
+	// the tokens that were counted for it
+	const bool okay = value_result && (to.src ? cut && state.src == to.src
+				: !cut && *state.src == '\0')
+		&& (!isarr || state.t == state.tend);
+	const size_t ntoks = state.t - state.tbase;
+	if (okay && ntoks) part->len = isarr ? elems : t->len - 1;
+	part->res = (ejresult_t){
+		.err = !okay,
+		.loc = okay ? NULL : state.src,
+		.ntoks = ntoks,
+	};
+	return part->res;
+}
+
+ejresult_t ejsplit_join(ejtok_t *t, const ejpart_t *parts, size_t nparts) {
+	size_t len = 0, ntoks = 0;
+	for (size_t i = 0; i < nparts; i++) {
+		if (parts[i].res.err) {
+			return (ejresult_t){
+				.err = true,
+				.full = parts[i].res.full,
+				.loc = parts[i].res.loc,
+				.ntoks = ntoks + parts[i].res.ntoks,
+			};
+		}
+		len += parts[i].len;
+		ntoks += parts[i].res.ntoks;
+	}
+
+	// Every part can fit while all of them together don't (see toobig)
+	if (ntoks && toobig(0, ntoks - 1)) {
+		return (ejresult_t){ .err = true, .ntoks = ntoks };
+	}
+	if (ntoks) t->len = len + 1;
+	return (ejresult_t){ .err = false, .loc = NULL, .ntoks = ntoks };
+}
+
+// Returns whether or not the escape charcter is valid (usually is)
+// Updates state with the newly escaped character
+static bool escape(ejstr_state_t *state) {
+	// Check if its a normal escape charater
+	if (*++state->src != 'u') {
+		// Write out the byte if we can
+		if (state->out < state->end) {
+			// Use escapes table to map to unescaped char
+			*state->out++ = unescape[*state->src];
+		}
+
+		// Increment src ptr, len and exit early
+		++state->src, ++state->len;
+		return true;
 	}
 
 	// We are parsing a unicode escape char
@@ -1144,6 +3172,176 @@ static bool escape(ejstr_state_t *state) {
 	return true;
 }
 
+#if EKJSON_X86
+// Same as pagesafe, but if the input has an end the block has to be before it
+static EKJSON_ALWAYS_INLINE bool blksafe(const char *const p, const size_t w,
+					const char *const end) {
+	return end ? end - p >= (ptrdiff_t)w : pagesafe(p, w);
+}
+
+// String kernels, each works on 1 block of an implementation
+//  - blkstop: mask of the '"' and '\\' chars
+//  - blkneq: mask of the chars that are different in 2 blocks
+//  - blkcpy: copies the block
+static inline EKJSON_TARGET("sse2") uint64_t blkstop_sse2(const char *src) {
+	const __m128i x = _mm_loadu_si128((const __m128i *)src);
+	return (uint16_t)_mm_movemask_epi8(
+		_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')),
+			_mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))));
+}
+static inline EKJSON_TARGET("sse4.2") uint64_t blkstop_sse42(const char *src) {
+	const __m128i set = _mm_cvtsi32_si128('"' | '\\' << 8);
+	const __m128i x = _mm_loadu_si128((const __m128i *)src);
+	return (uint16_t)_mm_cvtsi128_si32(_mm_cmpistrm(set, x,
+		_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK));
+}
+static inline EKJSON_TARGET("avx2") uint64_t blkstop_avx2(const char *src) {
+	const __m256i x = _mm256_loadu_si256((const __m256i *)src);
+	return (uint32_t)_mm256_movemask_epi8(
+		_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')),
+			_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))));
+}
+static inline EKJSON_TARGET("avx512bw")
+uint64_t blkstop_avx512bw(const char *src) {
+	const __m512i x = _mm512_loadu_si512((const void *)src);
+	return _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('"'))
+		| _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('\\'));
+}
+static inline EKJSON_TARGET("sse2")
+uint64_t blkneq_sse2(const char *a, const char *b) {
+	return (uint16_t)~_mm_movemask_epi8(_mm_cmpeq_epi8(
+		_mm_loadu_si128((const __m128i *)a),
+		_mm_loadu_si128((const __m128i *)b)));
+}
+static inline EKJSON_TARGET("avx2")
+uint64_t blkneq_avx2(const char *a, const char *b) {
+	return (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+		_mm256_loadu_si256((const __m256i *)a),
+		_mm256_loadu_si256((const __m256i *)b)));
+}
+static inline EKJSON_TARGET("avx512bw")
+uint64_t blkneq_avx512bw(const char *a, const char *b) {
+	return _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *)a),
+					_mm512_loadu_si512((const void *)b));
+}
+static inline EKJSON_TARGET("sse2") void blkcpy_sse2(char *out, const char *src) {
+	_mm_storeu_si128((__m128i *)out,
+			_mm_loadu_si128((const __m128i *)src));
+}
+static inline EKJSON_TARGET("avx2") void blkcpy_avx2(char *out, const char *src) {
+	_mm256_storeu_si256((__m256i *)out,
+			_mm256_loadu_si256((const __m256i *)src));
+}
+static inline EKJSON_TARGET("avx512bw")
+void blkcpy_avx512bw(char *out, const char *src) {
+	_mm512_storeu_si512((void *)out, _mm512_loadu_si512((const void *)src));
+}
+
+// Picks the string kernel of the implementation. These are only ever called
+// with a constant impl from functions built for that implementation.
+static EKJSON_ALWAYS_INLINE size_t blkw(const int impl) {
+	return impl == EJIMPL_AVX512BW ? 64 : impl == EJIMPL_AVX2 ? 32 : 16;
+}
+static EKJSON_ALWAYS_INLINE uint64_t blkstop(const char *src, const int impl) {
+	switch (impl) {
+	case EJIMPL_SSE2: return blkstop_sse2(src);
+	case EJIMPL_SSE42: return blkstop_sse42(src);
+	case EJIMPL_AVX2: return blkstop_avx2(src);
+	default: return blkstop_avx512bw(src);
+	}
+}
+static EKJSON_ALWAYS_INLINE uint64_t blkneq(const char *a, const char *b,
+						const int impl) {
+	switch (impl) {
+	case EJIMPL_SSE2: case EJIMPL_SSE42: return blkneq_sse2(a, b);
+	case EJIMPL_AVX2: return blkneq_avx2(a, b);
+	default: return blkneq_avx512bw(a, b);
+	}
+}
+static EKJSON_ALWAYS_INLINE void blkcpy(char *out, const char *src,
+					const int impl) {
+	switch (impl) {
+	case EJIMPL_SSE2: case EJIMPL_SSE42: blkcpy_sse2(out, src); break;
+	case EJIMPL_AVX2: blkcpy_avx2(out, src); break;
+	default: blkcpy_avx512bw(out, src); break;
+	}
+}
+
+// Copies blocks of plain chars until the first '"' or '\\', leaving
+// state->src there. Doesn't read past end if there is one.
+static EKJSON_ALWAYS_INLINE void copyblks(ejstr_state_t *const state,
+					const char *const end,
+					const int impl) {
+	const size_t w = blkw(impl);
+	for (;;) {
+		if (!blksafe(state->src, w, end)) {
+			// Go byte by byte until the next page
+			if (*state->src == '"' || *state->src == '\\') return;
+			if (state->out < state->end) *state->out++ = *state->src;
+			++state->src, ++state->len;
+			continue;
+		}
+
+		const uint64_t stop = blkstop(state->src, impl);
+		const size_t n = stop ? ctz(stop) : w;
+		if (state->end - state->out >= (ptrdiff_t)w) {
+			// Chars after the '"' or '\\' get overwritten later
+			blkcpy(state->out, state->src, impl);
+			state->out += n;
+		} else {
+			for (size_t i = 0; i < n && state->out < state->end; i++) {
+				*state->out++ = state->src[i];
+			}
+		}
+
+		state->src += n, state->len += n;
+		if (stop) return;
+	}
+}
+
+// Compares blocks of plain chars until the first '"' or '\\', leaving src
+// there. Returns false if the strings are different before that. Doesn't read
+// past end if there is one.
+static EKJSON_ALWAYS_INLINE bool cmpblks(const char **const psrc,
+					const char **const pcstr,
+					const char *const end,
+					const int impl) {
+	const size_t w = blkw(impl);
+	const char *src = *psrc, *cstr = *pcstr;
+	for (;;) {
+		if (!blksafe(src, w, end) || !pagesafe(cstr, w)) {
+			// Go byte by byte until the next page
+			if (*src == '"' || *src == '\\') break;
+			if (*src++ != *cstr++) return false;
+			continue;
+		}
+
+		// Only the chars before the first '"' or '\\' are compared
+		const uint64_t stop = blkstop(src, impl);
+		if (blkneq(src, cstr, impl) & (stop ? (stop & -stop) - 1 : ~0ull)) {
+			return false;
+		}
+
+		const size_t n = stop ? ctz(stop) : w;
+		src += n, cstr += n;
+		if (stop) break;
+	}
+
+	*psrc = src, *pcstr = cstr;
+	return true;
+}
+#endif // EKJSON_X86
+
+#if !EKJSON_NO_BITWISE
+// Loads the next 8 bytes of a string. If there are less than 8 before end,
+// returns all '"'s instead so that the caller goes byte by byte from there.
+static EKJSON_ALWAYS_INLINE uint64_t strprobe(const char *const src,
+					const char *const end) {
+	if (end && end - src < 8) return ~0ull / 255 * '"';
+	return ldu64_unaligned(src);
+}
+#endif
+
 // Copies and escapes a json string/kv to a string buffer
 // Takes in json source, token, and the out buffer and out length
 // If out is non-null and outlen is greater than 0, it will write characters
@@ -1153,7 +3351,12 @@ static bool escape(ejstr_state_t *state) {
 // terminator so that length is always above 0 when there are no errors)
 // If the string contains an invalid utf-8 codepoint or surrogate, it will
 // return the length as 0 to signify error
-size_t ejstr(const char *src, char *out, const size_t outlen) {
+// Uses the string kernels of impl for runs of plain chars. If end isn't NULL,
+// the fast paths never read at or past it.
+static EKJSON_ALWAYS_INLINE size_t copystr(const char *src, char *out,
+					const size_t outlen,
+					const char *const end,
+					const int impl) {
 	// Initialize the escaping/copying state
 	ejstr_state_t state = {
 		.src = src + 1,	// Skip '"', and where we are in the string
@@ -1164,9 +3367,15 @@ size_t ejstr(const char *src, char *out, const size_t outlen) {
 		.len = 1,	// How long the string is (irrespective of buf)
 	};
 
+#if EKJSON_X86
+	// Go through whole blocks first, the 8 byte chunks below will stop
+	// right away after this
+	if (impl != EJIMPL_SCALAR) copyblks(&state, end, impl);
+#endif
+
 #if !EKJSON_NO_BITWISE
 	// Do everything in chunks of 8 bytes
-	uint64_t probe = ldu64_unaligned(state.src);
+	uint64_t probe = strprobe(state.src, end);
 
 	// If we go over this, then we should go to the slow route
 	char *const end8 = outlen ? (out ? out + outlen - 8 : NULL) : out;
@@ -1183,7 +3392,7 @@ size_t ejstr(const char *src, char *out, const size_t outlen) {
 				stu64_unaligned(state.out, probe);
 				// Skip past written data
 				state.out += 8;
-			} else if (state.out > state.end) {
+			} else if (state.out < state.end) {
 				// Create temporary src pointer
 				const char *tmp = state.src;
 
@@ -1202,7 +3411,7 @@ size_t ejstr(const char *src, char *out, const size_t outlen) {
 			// Add string length and skip past probed data
 			state.len += 8, state.src += 8;
 			// Get next 8-byte chunk
-			probe = ldu64_unaligned(state.src);
+			probe = strprobe(state.src, end);
 		}
 	}
 #endif
@@ -1225,19 +3434,45 @@ size_t ejstr(const char *src, char *out, const size_t outlen) {
 	// Return what the string length is regardless of buffer length
 	return state.len;
 }
+size_t ejstr(const char *src, char *out, const size_t outlen) {
+#if EKJSON_X86
+	return curimpl->str(src, out, outlen);
+#else
+	return copystr(src, out, outlen, NULL, EJIMPL_SCALAR);
+#endif
+}
+size_t ejstr_n(const char *src, size_t len, char *out, size_t outlen) {
+#if EKJSON_X86
+	return curimpl->strn(src, src + len, out, outlen);
+#else
+	return copystr(src, out, outlen, src + len, EJIMPL_SCALAR);
+#endif
+}
 
 // Compares the string token to a normal c string, escaping characters as
 // needed and returning whether or not they are equal. Passing in null for
 // tok_start or cstr is undefined.
 // Renamed tok_start to src here since its used as the source pointer in this
 // implemenation
-bool ejcmp(const char *src, const char *cstr) {
+// Uses the string kernels of impl for runs of plain chars. If end isn't NULL,
+// the fast paths never read at or past it.
+static EKJSON_ALWAYS_INLINE bool cmpstr(const char *src, const char *cstr,
+					const char *const end,
+					const int impl) {
 	// Skip past the first '"' at the start of string token
 	src++;
 
+#if EKJSON_X86
+	// Go through whole blocks first, the 8 byte chunks below will stop
+	// right away after this
+	if (impl != EJIMPL_SCALAR && !cmpblks(&src, &cstr, end, impl)) {
+		return false;
+	}
+#endif
+
 #if !EKJSON_NO_BITWISE
 	// Initialize 8-byte probe
-	uint64_t probe = ldu64_unaligned(src);
+	uint64_t probe = strprobe(src, end);
 
 	// Continue comparing 8-byte chunks until we are less than 8 away from
 	// the end or we hit and escape
@@ -1250,7 +3485,7 @@ bool ejcmp(const char *src, const char *cstr) {
 			// Compare 8 bytes
 			if (probe != ldu64_unaligned(cstr)) return false;
 			src += 8, cstr += 8;	// If successful, goto next 8
-			probe = ldu64_unaligned(src);	// Load this row of 8
+			probe = strprobe(src, end); // Load this row of 8
 		}
 	}
 #endif
@@ -1264,13 +3499,14 @@ bool ejcmp(const char *src, const char *cstr) {
 				char buf[4];	// Temporary buffer
 				const size_t len = hex2utf8(++src, buf);
 
-				// Check to see if the next 32 bits, when
-				// masked off to fit the length of the
-				// outputted utf-8 are equal
-				if (len == 0	// Output len is 0 if error
-					|| ldu32_unaligned(buf) << len * 8
-					!= ldu32_unaligned(cstr) << len * 8) {
-					return false;
+				// Check to see if the next len bytes of the
+				// c string are the outputted utf-8 (a \u0000
+				// can't be in a c string)
+				if (len == 0) return false; // 0 if error
+				for (size_t i = 0; i < len; i++) {
+					if (buf[i] != cstr[i] || !cstr[i]) {
+						return false;
+					}
 				}
 				
 				// The bytes are equal so skip past the utf-8
@@ -1290,10 +3526,825 @@ bool ejcmp(const char *src, const char *cstr) {
 	// end of the c string
 	return *cstr == '\0';
 }
+bool ejcmp(const char *src, const char *cstr) {
+#if EKJSON_X86
+	return curimpl->cmp(src, cstr);
+#else
+	return cmpstr(src, cstr, NULL, EJIMPL_SCALAR);
+#endif
+}
+bool ejcmp_n(const char *src, size_t len, const char *cstr) {
+#if EKJSON_X86
+	return curimpl->cmpn(src, src + len, cstr);
+#else
+	return cmpstr(src, cstr, src + len, EJIMPL_SCALAR);
+#endif
+}
+
+// Hashes the key at tok_start (first quote) the same as ejparse_hashes does
+static uint64_t hashtok(const char *tok_start) {
+	// Find the closing quote to hash the key
+	const char *const key = tok_start + 1;
+	const char *end = key;
+	for (; *end != '"'; end += *end == '\\' ? 2 : 1);
+	return hashkey(key, end, true);
+}
+
+// Each slot is the top 32 bits of the key's hash and the offset of the key
+// from the object in the bottom, which is never 0 so 0 is an empty slot.
+// Objects with keys further than that from them (only with EKJSON_LARGE)
+// can't be indexed.
+bool ejindex(ejindex_t *index, const char *src, const ejtok_t *obj,
+		const uint64_t *hashes, uint64_t *slots, size_t nslots) {
+	size_t n = 0;
+	for (size_t i = 1; i < obj->len; i += obj[i].len, n++) {
+		if (i > UINT32_MAX) return false;
+	}
+	if (!nslots || nslots & (nslots - 1) || n >= nslots) return false;
+	*index = (ejindex_t){
+		.src = src, .obj = obj,
+		.slots = slots, .mask = nslots - 1,
+	};
+	for (size_t i = 0; i < nslots; i++) slots[i] = 0;
+
+	// Keys that are in the object more than once go later in the probe
+	// sequence, so ejfind finds the first one
+	for (size_t i = 1; i < obj->len; i += obj[i].len) {
+		const char *const key = src + obj[i].start;
+		const uint64_t h = hashes ? hashes[i] : hashtok(key);
+		size_t j = h & index->mask;
+		while (slots[j]) j = (j + 1) & index->mask;
+		slots[j] = (h >> 32) << 32 | i;
+	}
+	return true;
+}
+
+const ejtok_t *ejfind(const ejindex_t *index, const char *key) {
+	const char *end = key;
+	while (*end) end++;
+	const uint64_t h = hashkey(key, end, false);
+
+	for (size_t j = h & index->mask; index->slots[j];
+		j = (j + 1) & index->mask) {
+		const uint64_t slot = index->slots[j];
+		const ejtok_t *const tok = index->obj + (uint32_t)slot;
+		if (slot >> 32 == h >> 32
+			&& ejcmp(index->src + tok->start, key)) {
+			return tok;
+		}
+	}
+	return NULL;
+}
+
+// Each slot is the top 32 bits of the name's hash and the index of the
+// field + 1 in the bottom, so 0 is an empty slot
+bool ejschema(ejschema_t *schema, const ejfield_t *fields, size_t nfields,
+		uint64_t *slots, size_t nslots) {
+	if (!nslots || nslots & (nslots - 1) || nfields >= nslots) return false;
+	*schema = (ejschema_t){
+		.fields = fields, .nfields = nfields,
+		.slots = slots, .mask = nslots - 1,
+	};
+	for (size_t i = 0; i < nslots; i++) slots[i] = 0;
+
+	for (size_t i = 0; i < nfields; i++) {
+		const ejfield_t *const f = fields + i;
+		switch (f->type) {
+		case EJINT:
+			if (f->size != 1 && f->size != 2 && f->size != 4
+				&& f->size != 8) return false;
+			break;
+		case EJFLT:
+			if (f->size != sizeof(float)
+				&& f->size != sizeof(double)) return false;
+			break;
+		case EJSTR: if (!f->size) return false; break;
+		case EJBOOL: break;
+		case EJOBJ: if (!f->obj) return false; break;
+		default: return false;
+		}
+
+		const char *end = f->name;
+		while (*end) end++;
+		const uint64_t h = hashkey(f->name, end, false);
+		size_t j = h & schema->mask;
+		while (slots[j]) j = (j + 1) & schema->mask;
+		slots[j] = (h >> 32) << 32 | (i + 1);
+	}
+	return true;
+}
+
+// Finds the field of the key at tok_start with hash h, NULL if there is none
+static const ejfield_t *findfield(const ejschema_t *schema,
+				const char *tok_start, const uint64_t h) {
+	for (size_t j = h & schema->mask; schema->slots[j];
+		j = (j + 1) & schema->mask) {
+		const uint64_t slot = schema->slots[j];
+		const ejfield_t *const f = schema->fields + (uint32_t)slot - 1;
+		if (slot >> 32 == h >> 32 && ejcmp(tok_start, f->name)) return f;
+	}
+	return NULL;
+}
+
+// Converts the value at tok_start and puts it in the member at dst. Returns
+// false if the value isn't the field's type or doesn't fit. Objects are left
+// for the caller.
+static bool bindval(const ejfield_t *f, const enum ejtok_type type,
+			const char *tok_start, char *dst) {
+	if (type == EJNULL) return true;
+	switch (f->type) {
+	case EJINT: {
+		if (type != EJINT) return false;
+		const int64_t x = ejint(tok_start);
+		switch (f->size) {
+		case 1:
+			if (x != (int8_t)x) return false;
+			*(int8_t *)dst = x;
+			break;
+		case 2:
+			if (x != (int16_t)x) return false;
+			*(int16_t *)dst = x;
+			break;
+		case 4:
+			if (x != (int32_t)x) return false;
+			*(int32_t *)dst = x;
+			break;
+		default: *(int64_t *)dst = x; break;
+		}
+		return true;
+	}
+	case EJFLT:
+		if (type != EJFLT && type != EJINT) return false;
+		if (f->size == sizeof(float)) *(float *)dst = ejflt(tok_start);
+		else *(double *)dst = ejflt(tok_start);
+		return true;
+	case EJSTR: {
+		if (type != EJSTR) return false;
+		const size_t len = ejstr(tok_start, dst, f->size);
+		return len && len <= f->size;
+	}
+	case EJBOOL:
+		if (type != EJBOOL) return false;
+		*(bool *)dst = ejbool(tok_start);
+		return true;
+	default: return false;
+	}
+}
+
+bool ejbind(const ejschema_t *schema, const char *src, const ejtok_t *obj,
+		const uint64_t *hashes, void *out) {
+	if (obj->type != EJOBJ) return false;
+	for (size_t i = 1; i < obj->len; i += obj[i].len) {
+		const char *const key = src + obj[i].start;
+		const ejfield_t *const f = findfield(schema, key,
+			hashes ? hashes[i] : hashtok(key));
+		if (!f) continue;
+
+		// Recursing is fine here since schemas can only go as deep as
+		// the structs they describe
+		const ejtok_t *const val = obj + i + 1;
+		char *const dst = (char *)out + f->offset;
+		if (f->type == EJOBJ && val->type == EJOBJ) {
+			if (!ejbind(f->obj, src, val, hashes ? hashes + i + 1
+				: NULL, dst)) return false;
+		} else if (!bindval(f, val->type, src + val->start, dst)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Binds the object at state->src (the '{') into out like ejbind, while
+// parsing it. Every token goes into the same one token buffer, so values of
+// keys that aren't in the schema are only checked by the document parser
+// and the bound ones are converted right from the source. depth is the
+// number of objects that are open, including this one.
+// Leaves state->src after the object and the whitespace after it
+static bool bindobj(state_t *const state, const ejschema_t *schema,
+			char *out, ejframe_t *const stack, const size_t nstack,
+			const size_t depth) {
+	// Members are gone through the same way as in document(), so the same
+	// commas (and keys) are let through as with ejparse
+	state->src = whitespace(state->src + 1);
+	while (*state->src != '}') {
+		// Parse the key and find its field
+		const char *const key = state->src;
+		if (!*key || !string(state, EJKV, false)) return false;
+		const ejfield_t *const f = findfield(schema, key,
+			hashkey(key + 1, state->src - 1, true));
+
+		state->src = whitespace(state->src);
+		if (*state->src++ != ':') return false;
+		state->src = whitespace(state->src);
+
+		// Nested structs are bound the same way, anything else is
+		// parsed with what's left of the stack and then converted
+		const char *const val = state->src;
+		if (f && f->type == EJOBJ && *val == '{') {
+			if (depth >= nstack || !bindobj(state, f->obj,
+				out + f->offset, stack, nstack, depth + 1)) {
+				return false;
+			}
+		} else {
+			if (!*val || !parse(state, stack, nstack - depth)) {
+				return false;
+			}
+			const int type = *val == '{' ? EJOBJ
+				: *val == '[' ? EJARR : state->tbase->type;
+			if (f && !bindval(f, type, val, out + f->offset)) {
+				return false;
+			}
+		}
+
+		if (*state->src == ',') state->src = whitespace(state->src + 1);
+	}
+	state->src = whitespace(state->src + 1);
+	return true;
+}
+
+ejresult_t ejparse_bind(const char *src, const ejschema_t *schema,
+			void *out) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	ejtok_t tok;
+	state_t state = {
+		.base = src, .src = whitespace(src),
+		.tbase = &tok, .tend = &tok, .t = &tok,
+	};
+
+	const bool value_result = *state.src == '{'
+		&& bindobj(&state, schema, out, stack, ARRLEN(stack), 1);
+
+	// Same fix as in deep for strings that error on the null-terminator
+	if (!value_result && state.src > state.base && state.src[-1] == '\0') {
+		state.src--;
+	}
+	return value_result && *state.src == '\0'
+		? (ejresult_t){ .err = false }
+		: (ejresult_t){ .err = true, .loc = state.src };
+}
+
+// Returns the char after the value at src without checking it, or NULL if
+// the document ends first. Only brackets and the quotes and backslashes of
+// strings are looked at, so mismatched brackets aren't found.
+static const char *skip_scalar(const char *src) {
+	if (*src == '"') {
+		// skipstr stops at the null-terminator if the string doesn't end
+		const char *const end = skipstr(src, NULL);
+		return *end || (end - 1 != src && end[-1] == '"'
+			&& !isescaped(src, end - 1)) ? end : NULL;
+	}
+	if (*src != '{' && *src != '[') {
+		const char *const end = skipscalar(src, NULL);
+		return end != src ? end : NULL;
+	}
+
+	size_t depth = 0;
+	do {
+		switch (*src++) {
+		case '"': src = skipstr(src - 1, NULL); break;
+		case '{': case '[': depth++; break;
+		case '}': case ']': depth--; break;
+		case '\0': return NULL;
+		}
+	} while (depth);
+	return src;
+}
+
+// Puts the cursor on the value at src (or the whitespace before it). Strings,
+// numbers and literals are checked like ejparse would, the insides of objects
+// and arrays are left for when the cursor goes into them.
+static bool curset(ejcursor_t *const c, const char *const key,
+			const char *src) {
+	src = whitespace(src);
+	ejtok_t tok;
+	state_t state = {
+		.base = src, .src = src,
+		.tbase = &tok, .tend = &tok, .t = &tok,
+	};
+
+	const ejtok_t *res;
+	switch (*src) {
+	case '{': tok.type = EJOBJ, res = &tok; break;
+	case '[': tok.type = EJARR, res = &tok; break;
+	case '"': res = string(&state, EJSTR, false); break;
+	case '-': case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+		res = number(&state);
+		break;
+	case 't': case 'f': res = boolean(&state); break;
+	case 'n': res = null(&state); break;
+	default: return false;
+	}
+	if (!res) return false;
+
+	*c = (ejcursor_t){ .val = src, .key = key, .type = tok.type };
+	return true;
+}
+
+// Puts the cursor on the value of the key at src (in an object)
+static bool curkey(ejcursor_t *const c, const char *src) {
+	const char *const key = src;
+	if (*src != '"') return false;
+	src = whitespace(skipstr(src, NULL));
+	return *src == ':' && curset(c, key, src + 1);
+}
+
+const char *ejskip(const char *tok_start) {
+#if EKJSON_X86
+	return curimpl->skip(tok_start);
+#else
+	return skip_scalar(tok_start);
+#endif
+}
+
+ejcursor_t ejcursor(const char *src) {
+	ejcursor_t c = { .val = NULL };
+	curset(&c, NULL, src);
+	return c;
+}
+
+bool ejcursor_child(ejcursor_t *c) {
+	if (!c->val || (c->type != EJOBJ && c->type != EJARR)) return false;
+	const char *const src = whitespace(c->val + 1);
+	if (c->type == EJOBJ) return curkey(c, src);
+	return *src != ']' && curset(c, NULL, src);
+}
+
+bool ejcursor_next(ejcursor_t *c) {
+	if (!c->val) return false;
+	const char *src = ejskip(c->val);
+	if (!src || *(src = whitespace(src)) != ',') return false;
+	src = whitespace(src + 1);
+	return c->key ? curkey(c, src) : curset(c, NULL, src);
+}
+
+bool ejcursor_find(ejcursor_t *c, const char *key) {
+	if (!c->val || c->type != EJOBJ) return false;
+	ejcursor_t it = *c;
+	for (bool ok = ejcursor_child(&it); ok; ok = ejcursor_next(&it)) {
+		if (ejcmp(it.key, key)) {
+			*c = it;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ejcursor_at(ejcursor_t *c, size_t i) {
+	if (!c->val || c->type != EJARR) return false;
+	ejcursor_t it = *c;
+	if (!ejcursor_child(&it)) return false;
+	for (; i; i--) {
+		if (!ejcursor_next(&it)) return false;
+	}
+	*c = it;
+	return true;
+}
+
+// What a step of a filter goes to (ejstep_t.kind)
+enum {
+	STEP_KEY,	// The value of a key (name, len and hash)
+	STEP_IDX,	// An element of an array (idx)
+	STEP_ALL,	// Every element of an array
+	STEP_PTR,	// Key with ~ escapes from a pointer, or an index
+};
+
+// Hashes a key from a JSON pointer (src to end) the same way hashkey does
+// with the key it's for, ~0 and ~1 being '~' and '/'
+static uint64_t hashref(const char *src, const char *const end) {
+	uint64_t h = 0, w = 0;
+	size_t len = 0;
+	for (; src != end; src++, len++) {
+		const char c = *src != '~' ? *src : *++src == '0' ? '~' : '/';
+		w |= (uint64_t)(uint8_t)c << len % 8 * 8;
+		if (len % 8 == 7) h = hashmix(h, w), w = 0;
+	}
+	return hashmix(hashmix(h, w), len);
+}
+
+// Reads the part of a JSON pointer at path (after the '/') into step.
+// Returns the char after it or NULL if it has a bad ~ escape.
+static const char *ptrstep(const char *path, ejstep_t *const step) {
+	*step = (ejstep_t){ .kind = STEP_PTR, .name = path, .idx = UINT32_MAX };
+	for (; *path && *path != '/'; path++, step->len++) {
+		if (*path == '~' && *++path != '0' && *path != '1') return NULL;
+	}
+	step->hash = hashref(step->name, path);
+
+	// Only 0 and numbers that don't start with a 0 are array indexes
+	const char *num = step->name;
+	if (num == path || path - num > 9 || (*num == '0' && path - num > 1)) {
+		return path;
+	}
+	uint32_t idx = 0;
+	for (; num != path && *num >= '0' && *num <= '9'; num++) {
+		idx = idx * 10 + *num - '0';
+	}
+	if (num == path) step->idx = idx;
+	return path;
+}
+
+// Reads the step at the start of path into step. first is set for the first
+// step of a path, which is the only key that doesn't start with a '.'.
+// Returns the char after the step or NULL if it's malformed.
+static const char *pathstep(const char *path, const bool first,
+				ejstep_t *const step) {
+	*step = (ejstep_t){ .kind = STEP_KEY };
+	if (*path == '[') {
+		if (*++path == '*') {
+			step->kind = STEP_ALL;
+			path++;
+		} else {
+			const char *const start = path;
+			step->kind = STEP_IDX;
+			for (; *path >= '0' && *path <= '9'; path++) {
+				step->idx = step->idx * 10 + *path - '0';
+			}
+			if (path == start || path - start > 9) return NULL;
+		}
+		return *path == ']' ? path + 1 : NULL;
+	}
+
+	if (!first && *path++ != '.') return NULL;
+	step->name = path;
+	for (; *path && *path != '.' && *path != '['; path++);
+	if (path == step->name) return NULL;
+	step->len = path - step->name;
+	step->hash = hashkey(step->name, path, false);
+	return path;
+}
+
+// Returns the child of step s that is the same as step, or 0 if there isn't
+// one (the root is step 0, which is never a child)
+static uint32_t findchild(const ejfilter_t *const filter, const uint32_t s,
+				const ejstep_t *const step) {
+	for (uint32_t c = filter->steps[s].child; c;
+		c = filter->steps[c].next) {
+		const ejstep_t *const x = filter->steps + c;
+		if (x->kind != step->kind || x->idx != step->idx
+			|| x->len != step->len) continue;
+		uint32_t i = 0;
+		for (; i < x->len && x->name[i] == step->name[i]; i++);
+		if (i == x->len) return c;
+	}
+	return 0;
+}
+
+// Adds a new child to step s, returns 0 if there's no room
+static uint32_t newchild(ejfilter_t *const filter, const uint32_t s,
+			const ejstep_t *const step) {
+	if (filter->nsteps == filter->cap) return 0;
+	const uint32_t c = filter->nsteps++;
+	filter->steps[c] = *step;
+	filter->steps[c].child = 0;
+	filter->steps[c].next = filter->steps[s].child;
+	filter->steps[s].child = c;
+	return c;
+}
+
+// Copies the steps after step from into step to
+static bool copysteps(ejfilter_t *const filter, const uint32_t from,
+			const uint32_t to) {
+	filter->steps[to].whole |= filter->steps[from].whole;
+	for (uint32_t c = filter->steps[from].child; c;
+		c = filter->steps[c].next) {
+		const uint32_t n = newchild(filter, to, filter->steps + c);
+		if (!n || !copysteps(filter, c, n)) return false;
+	}
+	return true;
+}
+
+// Adds the rest of a path after step s. Elements with their own step go
+// wherever [*] goes too, so the paths after a [*] are also added to them (or
+// copied to them when they're added after it), and an element never has
+// more than one step to follow.
+static bool addpath(ejfilter_t *const filter, const uint32_t s,
+			const char *const path, const bool first) {
+	if (!*path) return filter->steps[s].whole = true;
+	ejstep_t step;
+	const char *const rest = pathstep(path, first, &step);
+	if (!rest) return false;
+
+	if (step.kind == STEP_ALL) {
+		for (uint32_t c = filter->steps[s].child; c;
+			c = filter->steps[c].next) {
+			if (filter->steps[c].kind == STEP_IDX
+				&& !addpath(filter, c, rest, false)) {
+				return false;
+			}
+		}
+	}
+
+	uint32_t c = findchild(filter, s, &step);
+	if (!c) {
+		const ejstep_t all = { .kind = STEP_ALL };
+		const uint32_t a = step.kind == STEP_IDX
+			? findchild(filter, s, &all) : 0;
+		if (!(c = newchild(filter, s, &step))
+			|| (a && !copysteps(filter, a, c))) return false;
+	}
+	return addpath(filter, c, rest, false);
+}
+
+bool ejfilter(ejfilter_t *filter, const char *const *paths, size_t npaths,
+		ejstep_t *steps, size_t nsteps) {
+	if (!nsteps || nsteps > UINT32_MAX) return false;
+	*filter = (ejfilter_t){ .steps = steps, .nsteps = 1, .cap = nsteps };
+	steps[0] = (ejstep_t){ .kind = STEP_KEY };
+	for (size_t i = 0; i < npaths; i++) {
+		if (!addpath(filter, 0, paths[i], true)) return false;
+	}
+	return true;
+}
+
+// Returns whether the key at tok_start is the name of step (which only has ~
+// escapes in it if it's from a pointer)
+static bool keyeq(const char *tok_start, const ejstep_t *const step) {
+	const char *src = tok_start + 1, *name = step->name;
+
+	// Most keys don't have escapes, so the chars are compared as they are
+	// until the first escape in either one
+	uint32_t i = 0;
+	for (; i < step->len && src[i] == name[i] && src[i] != '"'
+		&& src[i] != '\\' && name[i] != '~'; i++);
+	if (i == step->len) return src[i] == '"';
+	if (src[i] != '\\' && name[i] != '~') return false;
+	src += i, name += i;
+
+	while (*src != '"') {
+		char buf[4];
+		size_t n = 1;
+		if (*src != '\\') {
+			buf[0] = *src++;
+		} else if (*++src == 'u') {
+			if (!(n = hex2utf8(++src, buf))) return false;
+			src += n == 4 ? 10 : 4;
+		} else {
+			buf[0] = unescape[(uint8_t)*src++];
+		}
+
+		for (size_t j = 0; j < n; j++, i++) {
+			if (i == step->len) return false;
+			char c = *name++;
+			if (c == '~' && step->kind == STEP_PTR) {
+				c = *name++ == '0' ? '~' : '/';
+			}
+			if (buf[j] != c) return false;
+		}
+	}
+	return i == step->len;
+}
+
+// Returns the child of step s to follow for the key at tok_start, which is
+// len chars long without the quotes, or for element i of an array if
+// tok_start is NULL. 0 if there isn't one. Filters only have a few keys in
+// each object, so they're gone through in order, and most of the time the
+// length or first char is already different.
+static uint32_t nextstep(const ejfilter_t *const filter, const uint32_t s,
+			const char *const tok_start, const size_t len,
+			const size_t i) {
+	uint32_t all = 0;
+	for (uint32_t c = filter->steps[s].child; c;
+		c = filter->steps[c].next) {
+		const ejstep_t *const x = filter->steps + c;
+		if (tok_start) {
+			// Escapes only make keys shorter
+			if (x->kind == STEP_KEY && x->len <= len
+				&& keyeq(tok_start, x)) return c;
+		} else if (x->kind == STEP_IDX && x->idx == i) {
+			return c;
+		} else if (x->kind == STEP_ALL) {
+			all = c;
+		}
+	}
+	return all;
+}
+
+#if EKJSON_X86
+// Moves the index to the block that src is in, without indexing every block
+// in between like syncidx does (src can't be past the null-terminator)
+static void jumpidx(state_t *const state, const char *const src) {
+	if ((size_t)(src - state->blk) < 64) return;
+	startidx(state, src);
+}
+#endif
+
+// Parses the value at state->src with the document parser, with the index
+// if idx is set
+static bool parseval(state_t *const state, ejframe_t *const stack,
+			const size_t nstack, const bool idx) {
+#if EKJSON_X86
+	if (idx) return parse_idx(state, stack, nstack);
+#endif
+	return parse(state, stack, nstack);
+}
+
+// Parses the string, number, boolean or null at state->src, returns NULL if
+// it isn't one
+static EKJSON_ALWAYS_INLINE ejtok_t *scalar(state_t *const state,
+						const bool idx) {
+	switch (*state->src) {
+	case '"': return string(state, EJSTR, idx);
+	case '-': case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+		return number(state);
+	case 't': case 'f': return boolean(state);
+	case 'n': return null(state);
+	default: return NULL;
+	}
+}
+
+// Parses the value at state->src that step s of a filter goes to. Values at
+// the end of a path are parsed whole by the document parser (with what's
+// left of the stack), objects and arrays only get the members and elements
+// that a child of s goes to. Objects and arrays that no step goes to are
+// jumped over with ejskip, and other values are still parsed but their
+// tokens are taken back. depth is the number of objects and arrays that are
+// open.
+// Returns the token of the value, or NULL if an error occurred
+// Leaves state->src after the value and the whitespace after it
+static ejtok_t *filtered(state_t *const state, const ejfilter_t *filter,
+			const uint32_t s, ejframe_t *const stack,
+			const size_t nstack, const size_t depth,
+			const bool idx) {
+	const char *const val = state->src;
+	ejtok_t *const tok = state->t;
+	if (depth >= nstack || !*val) return NULL;
+	if (filter->steps[s].whole || (*val != '{' && *val != '[')) {
+		return parseval(state, stack, nstack - depth, idx) ? tok : NULL;
+	}
+
+	const bool obj = *val == '{';
+	addtok(state, obj ? EJOBJ : EJARR);
+	state->src = skipws(state, val + 1, idx);
+	if (*state->src == (obj ? '}' : ']')) goto end;
+
+	for (size_t i = 0;; i++) {
+		ejtok_t *const key = state->t;
+		uint32_t c;
+		if (obj) {
+			// Only keep the key if a step goes to its value
+			const char *const name = state->src;
+			if (*name != '"' || !string(state, EJKV, idx)) {
+				return NULL;
+			}
+			c = nextstep(filter, s, name, state->src - name - 2, i);
+			if (!c) state->t = key;
+
+			state->src = skipws(state, state->src, idx);
+			if (*state->src++ != ':') return NULL;
+			state->src = skipws(state, state->src, idx);
+		} else {
+			c = nextstep(filter, s, NULL, 0, i);
+		}
+
+		if (c) {
+			const ejtok_t *const v = filtered(state, filter, c,
+					stack, nstack, depth + 1, idx);
+			if (!v) return NULL;
+			if (obj) key->len += v->len;
+			tok->len += v->len + obj;
+		} else if (*state->src == '{' || *state->src == '[') {
+			const char *const end = ejskip(state->src);
+			if (!end) return NULL;
+#if EKJSON_X86
+			if (idx) jumpidx(state, end);
+#endif
+			state->src = skipws(state, end, idx);
+		} else {
+			ejtok_t *const mark = state->t;
+			if (!scalar(state, idx)) return NULL;
+			state->t = mark;
+			state->src = skipws(state, state->src, idx);
+		}
+
+		if (*state->src != ',') break;
+		state->src = skipws(state, state->src + 1, idx);
+	}
+	if (*state->src != (obj ? '}' : ']')) return NULL;
+
+end:
+	state->src = skipws(state, state->src + 1, idx);
+	return tok;
+}
+
+ejresult_t ejparse_filtered(const char *src, const ejfilter_t *filter,
+				ejtok_t *t, size_t nt) {
+	ejframe_t stack[EKJSON_MAX_DEPTH];
+	state_t state = {
+		.base = src, .src = whitespace(src),
+		.tbase = t, .tend = t + nt - 1, .t = t,
+	};
+
+#if EKJSON_X86
+	// Index the first block like deep does
+	const bool idx = (state.index = curimpl->index);
+	if (idx) {
+		startidx(&state, state.src);
+	}
+#else
+	const bool idx = false;
+#endif
+	bool value_result = filtered(&state, filter, 0, stack,
+				ARRLEN(stack), 0, idx);
+	if (state.over) value_result = false, state.src = state.over;
+
+	// Same fix as in deep for strings that error on the null-terminator
+	if (!value_result && state.src > state.base && state.src[-1] == '\0') {
+		state.src--;
+	}
+	const bool done = value_result && *state.src == '\0';
+	return done && state.t != state.tend
+		? (ejresult_t){ .err = false }
+		: (ejresult_t){
+			.err = true, .full = done, .loc = state.src,
+			.ntoks = state.t - state.tbase,
+		};
+}
+
+bool ejpath(ejpath_t *path, const char *expr, ejstep_t *steps, size_t nsteps) {
+	*path = (ejpath_t){ .steps = steps, .nsteps = 0 };
+	for (bool first = true; *expr; first = false) {
+		if (path->nsteps == nsteps) return false;
+		ejstep_t *const step = steps + path->nsteps++;
+		expr = *expr == '/' ? ptrstep(expr + 1, step)
+			: pathstep(expr, first, step);
+		if (!expr || step->kind == STEP_ALL) return false;
+	}
+	return true;
+}
+
+const ejtok_t *ejquery(const ejpath_t *path, const char *src,
+			const ejtok_t *t, const uint64_t *hashes) {
+	for (size_t s = 0; s < path->nsteps; s++) {
+		const ejstep_t *const step = path->steps + s;
+		size_t i = 1;
+		if (t->type == EJOBJ && step->kind != STEP_IDX) {
+			// Keys are only compared if their hashes are the same
+			for (; i < t->len; i += t[i].len) {
+				if ((!hashes || hashes[i] == step->hash)
+					&& keyeq(src + t[i].start, step)) break;
+			}
+			i++;
+		} else if (t->type == EJARR && step->idx != UINT32_MAX
+			&& step->kind != STEP_KEY) {
+			for (uint32_t n = 0; n < step->idx && i < t->len; n++) {
+				i += t[i].len;
+			}
+		} else {
+			return NULL;
+		}
+
+		if (i >= t->len) return NULL;
+		t += i;
+		if (hashes) hashes += i;
+	}
+	return t;
+}
+
+#if EKJSON_X86
+// Same as parsedigits8 using SSSE3 multiply-adds
+static inline EKJSON_TARGET("sse4.2")
+int digits8_sse42(const char *src, uint64_t *const out) {
+	// Bytes that aren't between 0-9 end up above 9
+	const __m128i x = _mm_sub_epi8(_mm_loadl_epi64((const __m128i *)src),
+					_mm_set1_epi8('0'));
+	const __m128i nine = _mm_set1_epi8(9);
+	const uint64_t wrong_bytes = ~_mm_movemask_epi8(
+		_mm_cmpeq_epi8(_mm_min_epu8(x, nine), x)) & 0xFF;
+	const int nright = wrong_bytes ? ctz(wrong_bytes) : 8;
+	if (!nright) {
+		*out = 0;
+		return 0;
+	}
+
+	// Move the ones place to the 8th byte, shuffling 0s in before the
+	// number (shuffle indices with the high bit set give 0)
+	__m128i val = _mm_shuffle_epi8(x, _mm_sub_epi8(
+		_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+			8, 9, 10, 11, 12, 13, 14, 15),
+		_mm_set1_epi8(8 - nright)));
+
+	// Same conversion as parsedigits8 (pairs, then quads, then all 8)
+	val = _mm_maddubs_epi16(val, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1,
+						10, 1, 10, 1, 10, 1, 10, 1));
+	val = _mm_madd_epi16(val, _mm_setr_epi16(100, 1, 100, 1,
+						100, 1, 100, 1));
+	val = _mm_packus_epi32(val, val);
+	val = _mm_madd_epi16(val, _mm_setr_epi16(10000, 1, 10000, 1,
+						10000, 1, 10000, 1));
+	*out = (uint32_t)_mm_cvtsi128_si32(val);
+	return nright;
+}
+#endif
 
 // Parses up to 8 digits and writes it to the out pointer. It how many of the
 // 8 bytes in this part of the string make up the number starting at the string
-static int EKJSON_INLINE parsedigits8(const char *src, uint64_t *const out) {
+static int EKJSON_INLINE parsedigits8(const char *src, uint64_t *const out,
+					const int impl) {
+#if EKJSON_X86
+	if (impl >= EJIMPL_SSE42) return digits8_sse42(src, out);
+#endif
 #if EKJSON_NO_BITWISE
 	*out = 0;
 	if (*src < '0' || *src > '9') return 0;
@@ -1355,7 +4406,8 @@ convert:
 
 // Parses a stream of base10 digits
 // Returns number of chars parsed, if overflow, returns 0 chars parsed
-static EKJSON_INLINE int parsebase10(const char *src, uint64_t *const out) {
+static EKJSON_INLINE int parsebase10(const char *src, uint64_t *const out,
+					const int impl) {
 	// Powers of 10 to shift by
 	static const uint64_t pows[9] = {
 		1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull,
@@ -1367,12 +4419,12 @@ static EKJSON_INLINE int parsebase10(const char *src, uint64_t *const out) {
 	
 	// Parse first 1-8 bytes of the number. If the number is 7 bytes or
 	// less, then we can be sure that we are done.
-	if ((n = parsedigits8(src, out)) < 8) return n;
+	if ((n = parsedigits8(src, out, impl)) < 8) return n;
 
 	// Parse next 8 byte section (this also accounts for the case that
 	// the number is truely a 8 byte number. So this section might have
 	// no number in it at all). We also apply the sign in this section
-	n = parsedigits8(src + 8, &tmp); // Put next 8 bytes into tmp
+	n = parsedigits8(src + 8, &tmp, impl); // Put next 8 bytes into tmp
 	
 	// Make 'room' for the new digits we are adding by shifting the old
 	// ones by n number of decimal places and add the new digits
@@ -1381,7 +4433,7 @@ static EKJSON_INLINE int parsebase10(const char *src, uint64_t *const out) {
 
 	// Since uint64_t can hold 16 digit values easily, we have to now check
 	// for overflow since we're going over that.
-	n = parsedigits8(src + 16, &tmp); // Put next 8 bytes into tmp
+	n = parsedigits8(src + 16, &tmp, impl); // Put next 8 bytes into tmp
 	
 	// Do the same as above but check if we overflowed
 	bool ovf = mul_overflow(*out, pows[n], out);
@@ -1392,7 +4444,8 @@ static EKJSON_INLINE int parsebase10(const char *src, uint64_t *const out) {
 // Returns the number token parsed as an int64_t. If there are decimals, it
 // just returns the number truncated towards 0. If the number is outside of
 // the int64_t range, it will saturate it to the closest limit.
-int64_t ejint(const char *const src) {
+static EKJSON_ALWAYS_INLINE int64_t parseint(const char *const src,
+						const int impl) {
 	// What the sign of the number is
 	const bool sign = *src == '-';
 
@@ -1401,8 +4454,42 @@ int64_t ejint(const char *const src) {
 
 	// Make sure it didn't also overflow the i64/u64 range,
 	// otherwise just return the correct sign
-	if (!parsebase10(src + sign, &x) || x > bound) return (int64_t)bound;
-	else return sign ? -(int64_t)x : (int64_t)x; // Apply sign
+	if (!parsebase10(src + sign, &x, impl) || x > bound) {
+		return (int64_t)bound;
+	}
+	return sign ? -(int64_t)x : (int64_t)x; // Apply sign
+}
+int64_t ejint(const char *const src) {
+#if EKJSON_X86
+	return curimpl->integer(src);
+#else
+	return parseint(src, EJIMPL_SCALAR);
+#endif
+}
+
+// The number parsers read up to 8 bytes at a time, so numbers that end less
+// than NUMTAIL chars from the end of a (ptr, len) input are copied into a
+// null-terminated buffer first. Only the first NUMCOPY - 1 chars are copied.
+#define NUMTAIL 16
+#define NUMCOPY 512
+
+// Returns where to parse the number at src from
+static const char *numtail(const char *const src, const char *const end,
+			char buf[static NUMCOPY + NUMTAIL]) {
+	const char *num = src;
+	for (; num != end && ((*num >= '0' && *num <= '9') || *num == '-'
+		|| *num == '+' || *num == '.' || *num == 'e' || *num == 'E');
+		num++);
+	if (end - num > NUMTAIL) return src;
+
+	size_t i = 0;
+	for (; i < NUMCOPY - 1 && src + i != num; i++) buf[i] = src[i];
+	for (; i < NUMCOPY + NUMTAIL; i++) buf[i] = '\0';
+	return buf;
+}
+int64_t ejint_n(const char *src, size_t len) {
+	char buf[NUMCOPY + NUMTAIL];
+	return ejint(numtail(src, src + len, buf));
 }
 
 // Auto-generated by gentbl.py, don't touch, regenerate instead.
@@ -1821,7 +4908,7 @@ static void addexp(const char *src, int32_t *exp) {
 
 	// Parse the exponent. Check early for obvious overflow, so we
 	// dont actually overflow the i32 by accident or else just add it
-	const bool bad = parsedigits8(src, &e) > 3 || e > 324;
+	const bool bad = parsedigits8(src, &e, EJIMPL_SCALAR) > 3 || e > 324;
 	*exp += esign ? -(int32_t)e : (int32_t)e;
 	if (bad) *exp = (int32_t)((uint32_t)INT32_MAX + esign);
 }
@@ -1842,7 +4929,8 @@ static EKJSON_NO_INLINE double slowflt(const char *src,
 	int n;			// Number of digits parsed in 1 run
 	do {
 		uint64_t run;
-		src += n = parsedigits8(src, &run); // Parse run of digits
+		// Parse run of digits
+		src += n = parsedigits8(src, &run, EJIMPL_SCALAR);
 
 		// Add these digits to the end
 		if (bigint_pow10(&sig, n)
@@ -1855,7 +4943,7 @@ frac:
 		src++;
 		do {
 			uint64_t run;
-			src += n = parsedigits8(src, &run);
+			src += n = parsedigits8(src, &run, EJIMPL_SCALAR);
 			e -= n; // Keep sig*10^e representative of actual num
 
 			// Add these digits to the end
@@ -1938,8 +5026,10 @@ frac:
 // Returns true if it could use the fast path. At this point since int_part
 // did not overflow, we can be sure that the whole integer part of the double
 // was parsed.
-static bool fastflt(const char *src, const uint64_t int_part,
-			const bool sign, double *result) {
+static EKJSON_ALWAYS_INLINE bool fastflt(const char *src,
+					const uint64_t int_part,
+					const bool sign, double *result,
+					const int impl) {
 	// Precalculated powers of 10 to shift the integer part of the
 	// significand by when parsing the fractional component
 	static const uint64_t shiftpows[] = {
@@ -1972,7 +5062,7 @@ static bool fastflt(const char *src, const uint64_t int_part,
 		// Shift significand and add fractional part on, while making
 		// sure not to overflow (abort to slow path)
 		int n; // Number of digits parsed by parsebase10
-		if (!(n = parsebase10(++src, &frac))
+		if (!(n = parsebase10(++src, &frac, impl))
 			|| mul_overflow(flt.mant, shiftpows[n], &flt.mant)
 			|| add_overflow(flt.mant, frac, &flt.mant)) {
 			return false;
@@ -2040,7 +5130,7 @@ static bool fastflt(const char *src, const uint64_t int_part,
 
 // Returns the number token as a float. If the number is out of the range that
 // can be represented, it will return either +/-inf.
-double ejflt(const char *src) {
+static EKJSON_ALWAYS_INLINE double parseflt(const char *src, const int impl) {
 	// Get the sign and skip it
 	const bool sign = *src == '-';
 	src += sign;
@@ -2055,10 +5145,21 @@ double ejflt(const char *src) {
 
 	// Try fast paths first and if they won't work use biguint and do slow
 	double result;
-	if (fastflt(src, i, sign, &result)) return result;
+	if (fastflt(src, i, sign, &result, impl)) return result;
 slowpath:
 	return slowflt(src, i, sign);
 }
+double ejflt(const char *src) {
+#if EKJSON_X86
+	return curimpl->flt(src);
+#else
+	return parseflt(src, EJIMPL_SCALAR);
+#endif
+}
+double ejflt_n(const char *src, size_t len) {
+	char buf[NUMCOPY + NUMTAIL];
+	return ejflt(numtail(src, src + len, buf));
+}
 
 // Returns whether the boolean is true or false
 bool ejbool(const char *tok_start) {
@@ -2066,3 +5167,140 @@ bool ejbool(const char *tok_start) {
 	return *tok_start == 't';
 }
 
+#if EKJSON_X86
+// Entry points built for each implementation. Integers and floats only have
+// an SSE4.2 version since the newer instruction sets don't help with 8 digits
+#define IMPL_STR(NAME, IMPL, TARGET) \
+	static TARGET size_t str_##NAME(const char *src, char *out, \
+					size_t outlen) { \
+		return copystr(src, out, outlen, NULL, IMPL); \
+	} \
+	static TARGET bool cmp_##NAME(const char *src, const char *cstr) { \
+		return cmpstr(src, cstr, NULL, IMPL); \
+	} \
+	static TARGET size_t strn_##NAME(const char *src, const char *end, \
+					char *out, size_t outlen) { \
+		return copystr(src, out, outlen, end, IMPL); \
+	} \
+	static TARGET bool cmpn_##NAME(const char *src, const char *end, \
+					const char *cstr) { \
+		return cmpstr(src, cstr, end, IMPL); \
+	}
+#define IMPL_NUM(NAME, IMPL, TARGET) \
+	static TARGET int64_t int_##NAME(const char *src) { \
+		return parseint(src, IMPL); \
+	} \
+	static TARGET double flt_##NAME(const char *src) { \
+		return parseflt(src, IMPL); \
+	}
+IMPL_STR(scalar, EJIMPL_SCALAR, )
+IMPL_STR(sse2, EJIMPL_SSE2, EKJSON_TARGET("sse2"))
+IMPL_STR(sse42, EJIMPL_SSE42, EKJSON_TARGET("sse4.2"))
+IMPL_STR(avx2, EJIMPL_AVX2, EKJSON_TARGET("avx2"))
+IMPL_STR(avx512bw, EJIMPL_AVX512BW, EKJSON_TARGET("avx512bw"))
+IMPL_NUM(scalar, EJIMPL_SCALAR, )
+IMPL_NUM(sse42, EJIMPL_SSE42, EKJSON_TARGET("sse4.2"))
+
+// Counting goes a lot faster with POPCNT, which comes with SSE4.2
+#define IMPL_COUNT(NAME, IMPL, TARGET) \
+	static TARGET ejsize_t count_##NAME(const char *src, \
+					const char *end) { \
+		return countblks(src, end, IMPL); \
+	}
+IMPL_COUNT(sse2, EJIMPL_SSE2, EKJSON_TARGET("sse2"))
+IMPL_COUNT(sse42, EJIMPL_SSE42, EKJSON_TARGET("sse4.2,popcnt"))
+IMPL_COUNT(avx2, EJIMPL_AVX2, EKJSON_TARGET("avx2,popcnt"))
+IMPL_COUNT(avx512bw, EJIMPL_AVX512BW, EKJSON_TARGET("avx512bw,popcnt"))
+#define IMPL_SCAN(NAME, IMPL, TARGET) \
+	static TARGET void scan_##NAME(const char *src, const char *end, \
+				bool esc, bool prevsc, ejpart_t *part) { \
+		scanblks(src, end, esc, prevsc, part, IMPL); \
+	}
+IMPL_SCAN(sse2, EJIMPL_SSE2, EKJSON_TARGET("sse2"))
+IMPL_SCAN(sse42, EJIMPL_SSE42, EKJSON_TARGET("sse4.2,popcnt"))
+IMPL_SCAN(avx2, EJIMPL_AVX2, EKJSON_TARGET("avx2,popcnt"))
+IMPL_SCAN(avx512bw, EJIMPL_AVX512BW, EKJSON_TARGET("avx512bw,popcnt"))
+#define IMPL_SKIP(NAME, IMPL, TARGET) \
+	static TARGET const char *skip_##NAME(const char *src) { \
+		return *src == '{' || *src == '[' ? skipblks(src, IMPL) \
+			: skip_scalar(src); \
+	}
+IMPL_SKIP(sse2, EJIMPL_SSE2, EKJSON_TARGET("sse2"))
+IMPL_SKIP(sse42, EJIMPL_SSE42, EKJSON_TARGET("sse4.2,popcnt"))
+IMPL_SKIP(avx2, EJIMPL_AVX2, EKJSON_TARGET("avx2,popcnt"))
+IMPL_SKIP(avx512bw, EJIMPL_AVX512BW, EKJSON_TARGET("avx512bw,popcnt"))
+#undef IMPL_STR
+#undef IMPL_NUM
+#undef IMPL_COUNT
+#undef IMPL_SCAN
+#undef IMPL_SKIP
+
+static const impl_t impls[EJIMPL_AUTO] = {
+	[EJIMPL_SCALAR] = {
+		NULL, str_scalar, cmp_scalar, int_scalar, flt_scalar,
+		count_scalar, strn_scalar, cmpn_scalar, scan_scalar,
+		skip_scalar, utf8_scalar,
+	},
+	[EJIMPL_SSE2] = {
+		index_sse2, str_sse2, cmp_sse2, int_scalar, flt_scalar,
+		count_sse2, strn_sse2, cmpn_sse2, scan_sse2, skip_sse2,
+		utf8_scalar,
+	},
+	[EJIMPL_SSE42] = {
+		index_sse42, str_sse42, cmp_sse42, int_sse42, flt_sse42,
+		count_sse42, strn_sse42, cmpn_sse42, scan_sse42, skip_sse42,
+		utf8_sse42,
+	},
+	[EJIMPL_AVX2] = {
+		index_avx2, str_avx2, cmp_avx2, int_sse42, flt_sse42,
+		count_avx2, strn_avx2, cmpn_avx2, scan_avx2, skip_avx2,
+		utf8_avx2,
+	},
+	[EJIMPL_AVX512BW] = {
+		index_avx512bw, str_avx512bw, cmp_avx512bw,
+		int_sse42, flt_sse42, count_avx512bw,
+		strn_avx512bw, cmpn_avx512bw, scan_avx512bw, skip_avx512bw,
+		utf8_avx2,
+	},
+};
+static const impl_t *curimpl = &impls[EJIMPL_SCALAR];
+
+// Best implementation the cpu supports. Every cpu with one of these also
+// supports the ones before it.
+static enum ejimpl bestimpl(void) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512bw")) return EJIMPL_AVX512BW;
+	if (__builtin_cpu_supports("avx2")) return EJIMPL_AVX2;
+	if (__builtin_cpu_supports("sse4.2")
+		&& __builtin_cpu_supports("popcnt")) return EJIMPL_SSE42;
+	if (__builtin_cpu_supports("sse2")) return EJIMPL_SSE2;
+	return EJIMPL_SCALAR;
+}
+
+// Picks the implementation once at startup
+static __attribute__((constructor)) void implinit(void) {
+	curimpl = &impls[bestimpl()];
+}
+#endif // EKJSON_X86
+
+// Returns the implementation in use
+enum ejimpl ejgetimpl(void) {
+#if EKJSON_X86
+	return (enum ejimpl)(curimpl - impls);
+#else
+	return EJIMPL_SCALAR;
+#endif
+}
+
+// Forces an implementation if the cpu supports it
+bool ejsetimpl(enum ejimpl impl) {
+#if EKJSON_X86
+	const enum ejimpl best = bestimpl();
+	if (impl == EJIMPL_AUTO) impl = best;
+	if ((unsigned)impl > (unsigned)best) return false;
+	curimpl = &impls[impl];
+	return true;
+#else
+	return impl == EJIMPL_SCALAR || impl == EJIMPL_AUTO;
+#endif
+}
@@ -21,10 +21,25 @@
  * =======================
  * Ekjson is meant to have a very small footprint on lines of code in your
  * project, especially when it comes to the API that ekjson exposes. Ekjson
- * exposes 3 main types of functions:
- *  - A function to parse documents into a buffer (ejparse)
- *  - Functions to compare and copy JSON strings (ejstr/ejcmp)
+ * exposes 8 main types of functions:
+ *  - Functions to size and parse documents into a buffer (ejcount/ejparse,
+ *    ejparse_many for newline-delimited JSON, ejparse_filtered for only
+ *    some paths)
+ *  - A streaming parser for documents that come in chunks (ejfeed)
+ *  - Functions to parse big arrays on many threads (ejsplit)
+ *  - A worker pool to parse newline-delimited JSON on many threads (ejpool,
+ *    when built with EKJSON_THREADS)
+ *  - Functions to compare and copy JSON strings (ejstr/ejcmp), and to find
+ *    keys in big objects (ejindex/ejfind) or paths in documents
+ *    (ejpath/ejquery)
  *  - Functions to read lightweight tokens (ejflt/ejint/ejbool)
+ *  - Functions to fill in c structs from objects (ejschema/ejbind, or
+ *    ejparse_bind to do it while parsing without any tokens)
+ *  - Cursors to read a few values out of a document without parsing all of
+ *    it (ejcursor, ejskip to jump over a value)
+ *
+ * Input that isn't null-terminated can go through the _n versions of these
+ * functions (ejparse_n, ejstr_n, etc.) which take a length instead.
  *
  * DOM Structure:
  * ==============
@@ -116,11 +131,9 @@
  * Features that I already have in mind but will put off until I need them are
  * as follows:
  *  1. Better error handling
- *  2. Find way to add array length parameter to EJARR tokens.
- *  3. More optmizations
- *  4. Cut down on code complexity
- *  5. SIMD implementations?
- *  6. Very basic JSON writer*
+ *  2. More optmizations
+ *  3. Cut down on code complexity
+ *  4. Very basic JSON writer*
  * 
  * > *I feel a JSON writer is beyond the scope of this project. This is due to
  * >  the fact that atleast for me, the library will mainly be used to
@@ -169,15 +182,47 @@
 #endif
 
 /**
- * \brief Max nesting for json values
+ * \brief Disables the SIMD kernels and runtime cpu dispatch
+ *
+ * On x86 with a GNU C compatible compiler, ekjson builds scalar, SSE2,
+ * SSE4.2, AVX2 and AVX-512BW versions of its hot paths (see \ref ejimpl) and
+ * picks the best one the cpu supports once at startup with cpuid. No special
+ * compiler flags are needed for this. When set, or on any other target, only
+ * the scalar code is built.
+ *
+ * Off by default.
+ */
+#ifndef EKJSON_NO_SIMD
+#define EKJSON_NO_SIMD 0
+#endif
+
+/**
+ * \brief Makes tokens big enough for documents over 4GB
+ *
+ * Normally \ref ejtok.start is 32 bits and \ref ejtok.len is 29 bits, so
+ * tokens are 8 bytes but documents can only be up to 4GB with up to 512M
+ * tokens (parsing anything bigger is an error where it stops fitting). When
+ * set, start is 64 bits and len is 61 bits, which makes tokens 16 bytes. The
+ * API doesn't change, but indices of tokens that ekjson puts in other buffers
+ * (like \ref ejparse_parents and \ref ejelems) are still 32 bits.
+ *
+ * Off by default.
+ */
+#ifndef EKJSON_LARGE
+#define EKJSON_LARGE 0
+#endif
+
+/**
+ * \brief Max nesting for json values in ejparse
  *
- * Max value depth that the json document can go.
- * Ekjson uses recurrsion so keep that in mind when setting this number. This
- * number also isn't representative of the actual limit of the callstack when
- * using ejparse, it's just a limit of recursion in general.
+ * Max value depth that the json document can go when using ejparse. Ekjson
+ * doesn't recurse, instead ejparse keeps an array of this many
+ * \ref ejframe_t on the callstack to remember the open objects and arrays
+ * (4KB by default, 8KB with \ref EKJSON_LARGE). For documents nested deeper
+ * than that, use \ref ejparse_deep with a buffer of your own.
  */
 #ifndef EKJSON_MAX_DEPTH
-#define EKJSON_MAX_DEPTH 64
+#define EKJSON_MAX_DEPTH 1024
 #endif
 
 /**
@@ -193,6 +238,24 @@
 #define EKJSON_MAX_SIG (1024 + 512)
 #endif
 
+/**
+ * \brief Adds a worker pool for parsing NDJSON on many threads (see
+ * \ref ejpool_many)
+ *
+ * When set, ekjson needs pthreads and the standard library (malloc) for the
+ * pool. Off by default, which keeps ekjson freestanding.
+ */
+#ifndef EKJSON_THREADS
+#define EKJSON_THREADS 0
+#endif
+
+/**
+ * \brief Maximum number of threads in a \ref ejpool
+ */
+#ifndef EKJSON_MAX_THREADS
+#define EKJSON_MAX_THREADS 64
+#endif
+
 /**
  * Each ekjson token is one of these types. These are here to make checking
  * ekjson types easier and to make traversing the DOM simpler as the types are
@@ -231,7 +294,7 @@ enum ejtok_type {
 	 * in this JSON array, it only represents 1 plus how many tokens this
 	 * array contains. If you know the tokens that *should* be in the array
 	 * you can get the length by subtracting 1 and dividing by how many
-	 * tokens each item is.
+	 * tokens each item is, or parse with \ref ejparse_counts to get it.
 	 */
 	EJARR,
 
@@ -302,7 +365,11 @@ typedef struct ejtok {
 	/**
 	 * \brief Offset from the start of the source string.
 	 */
+#if EKJSON_LARGE
+	uint64_t start;
+#else
 	uint32_t start;
+#endif
 
 	/**
 	 * \brief General type of the token (see \ref ejtok_type)
@@ -311,7 +378,11 @@ typedef struct ejtok {
 	 * \ref ejtok.len parameter also contains the length of the value they
 	 * hold.
 	 */
+#if EKJSON_LARGE
+	uint64_t type : 3;
+#else
 	uint32_t type : 3;
+#endif
 
 	/**
 	 * \brief Number of child tokens + 1
@@ -324,7 +395,11 @@ typedef struct ejtok {
 	 * - If this is a key token, then the length will also include the
 	 *   value it holds.
 	 */
+#if EKJSON_LARGE
+	uint64_t len : 61;
+#else
 	uint32_t len : 29;
+#endif
 } ejtok_t;
 
 /**
@@ -341,6 +416,15 @@ typedef struct ejresult {
 	 */
 	bool err;
 
+	/**
+	 * \brief True if the error was only from running out of tokens
+	 *
+	 * With \ref ejparse_resume and \ref ejfeed, parsing can go on from
+	 * where it stopped after giving the parser a bigger token buffer with
+	 * \ref ejparser_grow.
+	 */
+	bool full;
+
 	/**
 	 * \brief Rough location of where the error occured
 	 *
@@ -355,8 +439,9 @@ typedef struct ejresult {
 	 * \brief Number of tokens parsed
 	 *
 	 * If \ref ejresult returns that there was an error but this is set to
-	 * the maximum number of tokens, then we ran out of buffer room.
-	 * Reallocate and start from the begining.
+	 * the maximum number of tokens, then we ran out of buffer room
+	 * (see \ref ejresult.full). Reallocate and start from the begining, or
+	 * use \ref ejparse_resume so that you don't have to.
 	 *
 	 * \warning This is only a rough estimate if an error occured in
 	 * parsing.
@@ -378,78 +463,1282 @@ typedef struct ejresult {
 ejresult_t ejparse(const char *src, ejtok_t *t, size_t nt);
 
 /**
- * \brief Copies JSON key/string to c string buffer unescaping along the way
+ * \brief Same as \ref ejparse but also counts the elements of every
+ * array and object
  *
- * \warning If this function fails, the output buffer has undefined contents!
+ * An \ref ejtok_type.EJARR or \ref ejtok_type.EJOBJ token's len is how many
+ * tokens it spans, not how many elements or members it has. This puts the
+ * number of elements (or members) of the array (or object) at \p t[i] into
+ * \p counts[i], so that they don't have to be counted by walking the
+ * children first. The other entries of \p counts are left as they are.
  *
- * \param tok_start Pointer to start of \ref ejtok_type.EJSTR or
- *	\ref ejtok_type.EJKV token (first quote).
- * \param out Pointer to where the escaped string should be copied to. This
- *	buffer, even if not big enough for the resulting string, will always be
- *	null-terminated. If left NULL, the function will just return the length
- *	of the unescaped string.
- * \param outlen Length of the buffer pointed to by \p out. If this is left 0
- *	the function will only compute the length of the unescaped string and
- *	return it.
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON
+ * \param t Pointer to buffer to put the DOM into
+ * \param nt Size of the buffer pointed to by \p t
+ * \param counts Buffer with room for \p nt counts
  *
- * \returns Length of what the unescaped string would be if the buffer was
- *	large enough, including null terminator.
- *	\note This will be 0 if the string contains an invalid utf-8 codepoint
- *	or mangled utf-8 surrogate pair.
+ * \returns Result containg info on how parsing went (see \ref ejresult)
  */
-size_t ejstr(const char *tok_start, char *out, size_t outlen);
+ejresult_t ejparse_counts(const char *src, ejtok_t *t, size_t nt,
+			uint32_t *counts);
 
 /**
- * \brief Returns true if unescaped JSON string equals cstr
+ * \brief Same as \ref ejparse but also hashes every key
  *
- * Compares the string token to a normal c string, escaping characters as
- * needed and returning whether or not they are equal.
+ * Each key is hashed right after it's parsed, while it's still in the cache,
+ * and the hash of the key at \p t[i] is put in \p hashes[i]. These can be
+ * given to \ref ejindex so that it doesn't have to read the keys again, or
+ * be used to pick what to do with a key. The other entries of \p hashes are
+ * left as they are.
  *
- * \param tok_start Pointer to start of \ref ejtok_type.EJSTR or
- *	\ref ejtok_type.EJKV token (first quote).
- * \param cstr Non-NULL pointer to null-terminated c string.
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON
+ * \param t Pointer to buffer to put the DOM into
+ * \param nt Size of the buffer pointed to by \p t
+ * \param hashes Buffer with room for \p nt hashes
  *
- * \returns True if they match
+ * \returns Result containg info on how parsing went (see \ref ejresult)
  */
-bool ejcmp(const char *tok_start, const char *cstr);
+ejresult_t ejparse_hashes(const char *src, ejtok_t *t, size_t nt,
+			uint64_t *hashes);
 
 /**
- * \brief Converts int token to int64_t
+ * \brief Same as \ref ejparse but also puts down the parent of every token
  *
- * Parses base 10 integers.
+ * Tokens only point forward, so going up from a token otherwise means
+ * walking down from the root again. This puts the index of the token that
+ * \p t[i] is in into \p parents[i], so that things like finding the record
+ * a value is in or the path to a bad value only take as many steps as the
+ * value is deep. The parent of a value in an object is its
+ * \ref ejtok_type.EJKV key, the parent of a key is the object, the parent of
+ * an element is the array, and the root (\p t[0]) has UINT32_MAX.
  *
- * \param tok_start Pointer to start of \ref ejtok_type.EJINT.
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON
+ * \param t Pointer to buffer to put the DOM into
+ * \param nt Size of the buffer pointed to by \p t
+ * \param parents Buffer with room for \p nt indices
  *
- * \returns String converted to int64_t. If the number is outside of the
- * int64_t range, it will saturate it to the closest limit.
+ * \returns Result containg info on how parsing went (see \ref ejresult)
  */
-int64_t ejint(const char *tok_start);
+ejresult_t ejparse_parents(const char *src, ejtok_t *t, size_t nt,
+			uint32_t *parents);
 
 /**
- * \brief Converts float token to double
+ * \brief Same as \ref ejparse but fully validates every string
  *
- * Parses base 10 ECMA-404 float literals. If the number in tok_start has a
- * significand (after multiplying exponent) over \ref EKJSON_MAX_SIG, then the
- * function will return nan. To get this with default \ref EKJSON_MAX_SIG value
- * you would have to pass in a value with over ~100 sig figs with the max
- * or minimum exponent values.
+ * ejparse lets through strings that aren't valid UTF-8 and \\u escapes that
+ * aren't code points (like a lone surrogate), which \ref ejstr only finds
+ * later. This checks them too, so that untrusted input can be turned away up
+ * front. Since everything outside of strings is ASCII, the whole document is
+ * checked in one pass after it's parsed with the SIMD implementation in use
+ * (see \ref ejimpl), and \ref ejresult::loc points at the first bad byte or
+ * escape.
  *
- * \note Currently does not handle subnormal doubles. This may change in the
- * future, but I kept it this way due to me wanting to use this in real time
- * applications (where the subnormal overhead would be undesirable).
+ * \note WTF-8 (UTF-8 with encoded surrogates) isn't allowed here.
  *
- * \param tok_start Pointer to start of \ref ejtok_type.EJINT or
- *	\ref ejtok_type.EJFLT.
+ * \param src Null-terminated string containing JSON
+ * \param t Pointer to buffer to put the DOM into
+ * \param nt Size of the buffer pointed to by \p t
  *
- * \returns String converted to double. If the number is outside of the
- * double range, it will saturate to +/-INF.
+ * \returns Result containg info on how parsing went (see \ref ejresult)
  */
-double ejflt(const char *tok_start);
+ejresult_t ejparse_strict(const char *src, ejtok_t *t, size_t nt);
 
 /**
- * \brief Returns \ref ejtok_type.EJBOOL true or false no error handling needed
+ * \brief Checks a document the same way \ref ejparse does without making
+ * any tokens
+ *
+ * For when only whether or not the document is valid matters, so no token
+ * buffer has to be sized or allocated. Every value is written to the same
+ * token on the stack instead.
+ *
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON
+ * \param check If set, also does the checks that are normally left for
+ *	later: every string and key is checked like in \ref ejparse_strict,
+ *	and every number has to fit in a double (\ref ejflt doesn't return
+ *	inf or nan)
+ *
+ * \returns Result containg info on how parsing went (see \ref ejresult).
+ *	\ref ejresult.ntoks is always 0.
  */
-bool ejbool(const char *tok_start);
+ejresult_t ejvalidate(const char *src, bool check);
+
+/**
+ * \brief Makes an index of where the elements of an array are
+ *
+ * Getting to element k of an array normally means skipping over the k
+ * elements before it. After this, element k is at \p arr + \p idx[k], so
+ * arrays can be binary searched or sampled without walking them again.
+ * Works on objects too, where it gives the key of each member.
+ *
+ * \param arr Pointer to a \ref ejtok_type.EJARR or \ref ejtok_type.EJOBJ
+ *	token from a parsed document
+ * \param idx Buffer to put the offset of each element from \p arr into
+ * \param nidx Size of the buffer pointed to by \p idx. \p arr->len - 1 is
+ *	always enough, or the count from \ref ejparse_counts exactly.
+ *
+ * \returns Number of elements in the array. If this is more than \p nidx,
+ *	only the first \p nidx of them were put in \p idx. SIZE_MAX if one of
+ *	those is more than 4G tokens from \p arr (only with \ref EKJSON_LARGE).
+ */
+size_t ejelems(const ejtok_t *arr, uint32_t *idx, size_t nidx);
+
+/**
+ * \brief How big the buffers for a document need to be (see \ref ejcount)
+ */
+typedef struct ejsize {
+	/**
+	 * \brief Number of tokens the parsers will make
+	 *
+	 * \ref ejparse and \ref ejparse_deep need 2 more tokens than this in
+	 * their buffer, \ref ejfeed and \ref ejparse_resume need exactly this
+	 * many.
+	 */
+	size_t ntoks;
+
+	/**
+	 * \brief Most objects and arrays that are open at once
+	 *
+	 * A stack of depth + 1 frames is always enough for \ref ejparse_deep.
+	 */
+	size_t depth;
+} ejsize_t;
+
+/**
+ * \brief Counts the tokens in a document without making any
+ *
+ * Much faster than \ref ejparse since it only looks for the starts of values
+ * and doesn't validate anything, so the counts are only exact for valid JSON.
+ * Use it to size the buffers up front instead of guessing.
+ *
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON
+ *
+ * \returns Number of tokens and the depth of the document
+ */
+ejsize_t ejcount(const char *src);
+
+/**
+ * \brief Same as \ref ejcount but for input that isn't null-terminated
+ *
+ * \param src JSON to count the tokens of. Nothing at or after \p src + \p len
+ *	is used. The SIMD kernels read whole 64 byte aligned blocks, so they
+ *	can read up to the end of the block that \p src + \p len is in, which
+ *	can never fault.
+ * \param len Length of \p src
+ *
+ * \returns Number of tokens and the depth of the document
+ */
+ejsize_t ejcount_n(const char *src, size_t len);
+
+/**
+ * \brief An object or array that ejparse is still in the middle of parsing
+ *
+ * Only here so that the size is known for \ref ejparse_deep. One of these is
+ * used for each level of nesting in the document.
+ */
+typedef struct ejframe {
+	/**
+	 * \brief Index of the object or array token in the token buffer
+	 *
+	 * Shifted up by 1, the low bit is set for objects. The key of the
+	 * value being parsed is always the token right before it, so it
+	 * doesn't need to be kept.
+	 */
+#if EKJSON_LARGE
+	uint64_t tok;
+#else
+	uint32_t tok;
+#endif
+} ejframe_t;
+
+/**
+ * \brief Same as \ref ejparse but with a caller provided container stack
+ *
+ * ejparse can only go \ref EKJSON_MAX_DEPTH levels deep, this one can go as
+ * deep as \p nstack levels. The tokens and result are exactly the same as
+ * ejparse with \ref EKJSON_MAX_DEPTH set to \p nstack.
+ *
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON
+ * \param t Pointer to buffer to put the DOM into
+ * \param nt Size of the buffer pointed to by \p t
+ * \param stack Scratch buffer for the open objects and arrays
+ * \param nstack Size of the buffer pointed to by \p stack
+ *
+ * \returns Result containg info on how parsing went (see \ref ejresult)
+ */
+ejresult_t ejparse_deep(const char *src, ejtok_t *t, size_t nt,
+			ejframe_t *stack, size_t nstack);
+
+/**
+ * \brief Same as \ref ejparse but for input that isn't null-terminated
+ *
+ * For documents that are a slice of a bigger buffer (from the network or a
+ * mapped file), so that they don't have to be copied just to add a
+ * null-terminator. Nothing at or after \p src + \p len is ever read, and a
+ * null char before that is an error. This goes through the streaming parser
+ * (see \ref ejfeed), so it's slower than ejparse but only needs a buffer of
+ * exactly as many tokens as the document has.
+ *
+ * Use the _n versions of the other functions on the tokens with the length
+ * left in the input (\p len - \ref ejtok.start).
+ *
+ * \param src Valid UTF-8/WTF-8 string containing JSON
+ * \param len Length of \p src
+ * \param t Pointer to buffer to put the DOM into
+ * \param nt Size of the buffer pointed to by \p t
+ *
+ * \returns Result containg info on how parsing went (see \ref ejresult).
+ *	Unlike \ref ejparse, \ref ejresult.ntoks is always the number of
+ *	tokens parsed.
+ */
+ejresult_t ejparse_n(const char *src, size_t len, ejtok_t *t, size_t nt);
+
+/**
+ * \brief Same as \ref ejparse_n but with a caller provided container stack
+ *
+ * \param src Valid UTF-8/WTF-8 string containing JSON
+ * \param len Length of \p src
+ * \param t Pointer to buffer to put the DOM into
+ * \param nt Size of the buffer pointed to by \p t
+ * \param stack Scratch buffer for the open objects and arrays
+ * \param nstack Size of the buffer pointed to by \p stack
+ *
+ * \returns Result containg info on how parsing went (see \ref ejresult)
+ */
+ejresult_t ejparse_deep_n(const char *src, size_t len, ejtok_t *t, size_t nt,
+			ejframe_t *stack, size_t nstack);
+
+/**
+ * \brief Where one of the documents from \ref ejparse_many is
+ */
+typedef struct ejdoc {
+	/**
+	 * \brief Offset of the document's first char in the source
+	 */
+	size_t start;
+
+	/**
+	 * \brief Offset of the char after the document's last char
+	 *
+	 * If there was an error, this is the end of the line it started on
+	 * instead.
+	 */
+	size_t end;
+
+	/**
+	 * \brief Index of the document's first token in the token buffer
+	 */
+	size_t tok;
+
+	/**
+	 * \brief Number of tokens in the document, 0 if there was an error
+	 */
+	size_t ntoks;
+
+	/**
+	 * \brief True if the document had an error
+	 */
+	bool err;
+
+	/**
+	 * \brief Rough location of where the error occured, NULL if none did
+	 */
+	const char *loc;
+} ejdoc_t;
+
+/**
+ * \brief Result of \ref ejparse_many
+ */
+typedef struct ejmany {
+	/**
+	 * \brief Number of documents put in the document buffer
+	 */
+	size_t ndocs;
+
+	/**
+	 * \brief Number of tokens put in the token buffer
+	 */
+	size_t ntoks;
+
+	/**
+	 * \brief Start of the first document that didn't fit, or NULL
+	 *
+	 * Set when the token or document buffer ran out. Call
+	 * \ref ejparse_many again from here to parse the rest, the offsets are
+	 * then from here too.
+	 */
+	const char *next;
+} ejmany_t;
+
+/**
+ * \brief Parses newline-delimited JSON (NDJSON/JSON Lines) in one go
+ *
+ * Parses every document in \p src one after another into the same token
+ * buffer, without starting over for each of them. Nothing else can be on
+ * the line that a document ends on, and blank lines are skipped. If a
+ * document has an error, its tokens are dropped and parsing goes on from the
+ * line after the one it started on, so one bad line doesn't stop the rest
+ * from being parsed.
+ *
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing the
+ *	documents
+ * \param t Pointer to buffer to put the tokens of every document into
+ * \param nt Size of the buffer pointed to by \p t. Unlike \ref ejparse, this
+ *	can be exactly as many tokens as the documents have.
+ * \param docs Buffer to put where each document is into
+ * \param ndocs Size of the buffer pointed to by \p docs
+ *
+ * \returns How many documents and tokens were parsed, and where to go on from
+ *	if they didn't all fit (see \ref ejmany)
+ */
+ejmany_t ejparse_many(const char *src, ejtok_t *t, size_t nt,
+			ejdoc_t *docs, size_t ndocs);
+
+#if EKJSON_THREADS
+#include <pthread.h>
+
+/**
+ * \brief What one thread of a \ref ejpool parsed
+ *
+ * The documents are in the same order as in the source, and their offsets
+ * (and the offsets in their tokens) are from \ref ejshard.src. The buffers
+ * belong to the pool and are reused by the next \ref ejpool_many.
+ */
+typedef struct ejshard {
+	/**
+	 * \brief Start of the shard in the source
+	 */
+	const char *src;
+
+	/**
+	 * \brief Tokens of every document in the shard
+	 */
+	ejtok_t *t;
+
+	/**
+	 * \brief Where each document in the shard is (see \ref ejparse_many)
+	 */
+	ejdoc_t *docs;
+
+	/**
+	 * \brief Number of tokens in \ref ejshard.t
+	 */
+	size_t ntoks;
+
+	/**
+	 * \brief Number of documents in \ref ejshard.docs
+	 */
+	size_t ndocs;
+
+	/**
+	 * \brief True if the buffers couldn't grow enough for the whole shard
+	 *
+	 * The documents that were parsed before that are still there.
+	 */
+	bool oom;
+
+	/**
+	 * \brief Size of the buffers (only for ekjson)
+	 */
+	size_t tcap, dcap;
+} ejshard_t;
+
+/**
+ * \brief Threads that parse NDJSON together (see \ref ejpool_many)
+ *
+ * Set it up with \ref ejpool_init. Other than \ref ejpool.shards and
+ * \ref ejpool.nthreads, the fields are only for ekjson.
+ */
+typedef struct ejpool {
+	/**
+	 * \brief What each thread parsed, in the same order as the source
+	 */
+	ejshard_t shards[EKJSON_MAX_THREADS];
+
+	/**
+	 * \brief Number of threads and shards, including the calling thread
+	 */
+	size_t nthreads;
+
+	pthread_t threads[EKJSON_MAX_THREADS];
+	pthread_mutex_t lock;
+	pthread_cond_t go, done;
+	const char *src;
+	size_t cuts[EKJSON_MAX_THREADS + 1];
+	size_t nstarted, left;
+	uint64_t gen;
+	bool quit;
+} ejpool_t;
+
+/**
+ * \brief Starts the threads of a pool
+ *
+ * \param pool The pool to set up
+ * \param nthreads Number of threads to parse with, including the one that
+ *	calls \ref ejpool_many. Limited to \ref EKJSON_MAX_THREADS.
+ *
+ * \returns False if a thread couldn't be started
+ */
+bool ejpool_init(ejpool_t *pool, size_t nthreads);
+
+/**
+ * \brief Stops the threads of a pool and frees its buffers
+ */
+void ejpool_free(ejpool_t *pool);
+
+/**
+ * \brief Parses newline-delimited JSON on every thread of the pool
+ *
+ * Splits \p src into one shard per thread at line breaks, and parses each
+ * of them with \ref ejparse_many into buffers that belong to that thread.
+ * The buffers grow as needed and are kept for the next call, so a pool that
+ * gets used over and over stops allocating. The results are in
+ * \ref ejpool.shards, and going through the shards in order and then the
+ * documents in each of them gives the documents in the order of \p src.
+ *
+ * Every document has to be on one line, and each shard can be at most 4GB.
+ *
+ * \param pool The pool to parse with
+ * \param src Valid UTF-8/WTF-8 string containing the documents, with a null
+ *	char at \p src + \p len. A mapped file can be used as-is if its size
+ *	isn't a multiple of the page size, since the rest of the page is zeros.
+ * \param len Length of \p src
+ *
+ * \returns False if a shard ran out of memory (see \ref ejshard.oom)
+ */
+bool ejpool_many(ejpool_t *pool, const char *src, size_t len);
+#endif
+
+/**
+ * \brief State of a streaming parser (see \ref ejfeed)
+ *
+ * Lets a document be parsed in chunks as they come in instead of all at once.
+ * Set it up with \ref ejparser_init. Other than \ref ejparser.pos, the fields
+ * are only for ekjson.
+ */
+typedef struct ejparser {
+	/**
+	 * \brief Token buffer and the next place to put a token
+	 */
+	ejtok_t *tbase, *tend, *t;
+
+	/**
+	 * \brief Objects and arrays that are still open
+	 */
+	ejframe_t *stack;
+	size_t nstack, depth;
+
+	/**
+	 * \brief Token of the string/number/literal that is being parsed
+	 */
+	ejtok_t *tok;
+
+	/**
+	 * \brief The 'true', 'false' or 'null' that is being matched
+	 */
+	const char *lit;
+
+	/**
+	 * \brief Offset of the next chunk in the stream
+	 *
+	 * After an error this is the offset where the error occured instead.
+	 */
+	size_t pos;
+
+	/**
+	 * \brief What the parser is in the middle of and its progress
+	 */
+	uint8_t mode, s;
+} ejparser_t;
+
+/**
+ * \brief Sets up a streaming parser
+ *
+ * \param p Parser to set up
+ * \param t Pointer to buffer to put the DOM into. Has to stay around until
+ *	parsing is done.
+ * \param nt Size of the buffer pointed to by \p t
+ * \param stack Scratch buffer for the open objects and arrays. Has to stay
+ *	around until parsing is done.
+ * \param nstack Size of the buffer pointed to by \p stack
+ */
+void ejparser_init(ejparser_t *p, ejtok_t *t, size_t nt,
+		ejframe_t *stack, size_t nstack);
+
+/**
+ * \brief Parses the next chunk of a document
+ *
+ * Chunks can be cut off anywhere, even in the middle of strings, numbers and
+ * literals. Tokens are added to the buffer as soon as they start and their
+ * \ref ejtok.start is the offset in the whole stream, not in the chunk. So to
+ * use the tokens with the other functions the chunks have to be put together
+ * at some point (which can happen while they are being parsed). Once all of
+ * the chunks have been fed, feed an empty chunk (\p len of 0) to end the
+ * document.
+ *
+ * For a whole document this gives the same tokens as \ref ejparse_deep,
+ * except that it only needs a buffer of exactly as many tokens as the document
+ * has.
+ *
+ * \param p Parser set up with \ref ejparser_init
+ * \param chunk Next part of the document, isn't null-terminated and can't
+ *	contain any null chars
+ * \param len Length of \p chunk or 0 to end the document
+ *
+ * \returns Whether or not an error occured and the number of tokens so far.
+ *	\ref ejresult.loc points into \p chunk (see \ref ejparser.pos for the
+ *	exact offset). If \ref ejresult.full is set, the token buffer ran out of
+ *	room before \ref ejresult.loc, call \ref ejparser_grow and feed the
+ *	rest of the chunk from there. Once any other error occurs, every call
+ *	returns an error.
+ */
+ejresult_t ejfeed(ejparser_t *p, const char *chunk, size_t len);
+
+/**
+ * \brief Parses a whole document, stopping if the token buffer runs out
+ *
+ * Works just like \ref ejparse_deep with the buffers from
+ * \ref ejparser_init, except that when there is no room left for the next
+ * token it stops right there and returns with \ref ejresult.full set. Give
+ * the parser a bigger buffer with \ref ejparser_grow and call this again
+ * with the same \p src to keep going, nothing before that point gets parsed
+ * again.
+ *
+ * \param p Parser set up with \ref ejparser_init, and not used with
+ *	\ref ejfeed
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON, the
+ *	same one every call
+ *
+ * \returns Result containg info on how parsing went (see \ref ejresult).
+ *	Unlike \ref ejparse, \ref ejresult.ntoks is always the number of
+ *	tokens parsed.
+ */
+ejresult_t ejparse_resume(ejparser_t *p, const char *src);
+
+/**
+ * \brief Gives a parser that ran out of tokens a bigger buffer
+ *
+ * \param p Parser that returned \ref ejresult.full
+ * \param t New token buffer. It has to start with the tokens parsed so far,
+ *	like a buffer from realloc would. Can be the same buffer.
+ * \param nt Size of the buffer pointed to by \p t
+ */
+void ejparser_grow(ejparser_t *p, ejtok_t *t, size_t nt);
+
+/**
+ * \brief One thread's part of a top-level array parsed by many threads
+ *
+ * Big documents that are one top-level array can be parsed by n threads at
+ * once, each of them taking 1/n of the array's elements. ekjson doesn't start
+ * any threads itself, each of the threads calls the functions with their
+ * index i in the parts:
+ *
+ * \code
+ * ejsplit_scan(src, len, parts, n, i);
+ * // Wait for all of the threads to get here
+ * ejsplit_parse(src, len, t, nt, parts, n, i);
+ * // Wait for all of the threads, then on one of them
+ * const ejresult_t res = ejsplit_join(t, parts, n);
+ * \endcode
+ *
+ * The tokens are the same as if the whole document was parsed by
+ * \ref ejparse_deep. Documents that aren't an array are parsed all by the
+ * first part. The fields are only for ekjson.
+ */
+typedef struct ejpart {
+	/**
+	 * \brief Tokens that start in the part's chunk of the document
+	 *
+	 * If the chunk starts outside of a string, then inside of one
+	 */
+	size_t ntoks[2];
+
+	/**
+	 * \brief How much deeper the chunk ends than it starts
+	 *
+	 * If the chunk starts outside of a string, then inside of one
+	 */
+	int64_t depth[2];
+
+	/**
+	 * \brief If the chunk has an odd number of quotes
+	 */
+	bool flip;
+
+	/**
+	 * \brief Tokens of the part's elements, added to the array's length
+	 */
+	size_t len;
+
+	/**
+	 * \brief What \ref ejsplit_parse returned
+	 */
+	ejresult_t res;
+} ejpart_t;
+
+/**
+ * \brief Scans a chunk of a document for where strings and arrays are
+ *
+ * First step of parsing a document on many threads (see \ref ejpart).
+ * Splits the document into \p nparts even chunks and scans the i'th one,
+ * which is a lot faster than parsing it.
+ *
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON
+ * \param len Length of \p src
+ * \param parts Parts of every thread
+ * \param nparts Number of parts (and threads)
+ * \param i Part of this thread
+ */
+void ejsplit_scan(const char *src, size_t len, ejpart_t *parts, size_t nparts,
+		size_t i);
+
+/**
+ * \brief Parses one part of a document that was split between threads
+ *
+ * Second step of parsing a document on many threads (see \ref ejpart). Can
+ * only be called once every part has been scanned with \ref ejsplit_scan.
+ * Each part starts at the first element of the top-level array after the
+ * start of its chunk and puts its tokens right where they go in \p t. So the
+ * parts never write over each other's tokens.
+ *
+ * \param src Same as in \ref ejsplit_scan
+ * \param len Length of \p src
+ * \param t Buffer for the tokens of the whole document, shared by all of the
+ *	parts. It has to be big enough for all of them (see \ref ejcount).
+ * \param nt Size of the buffer pointed to by \p t
+ * \param parts Parts of every thread
+ * \param nparts Number of parts (and threads)
+ * \param i Part of this thread
+ *
+ * \returns Result containg info on how parsing the part went
+ *	(see \ref ejresult). \ref ejresult.ntoks is the number of tokens in
+ *	the part.
+ */
+ejresult_t ejsplit_parse(const char *src, size_t len, ejtok_t *t, size_t nt,
+			ejpart_t *parts, size_t nparts, size_t i);
+
+/**
+ * \brief Puts the parts of a document that was split between threads together
+ *
+ * Last step of parsing a document on many threads (see \ref ejpart). Can only
+ * be called once every part is done with \ref ejsplit_parse. Fixes up the
+ * length of the top-level array, the tokens are already in place.
+ *
+ * \param t Same as in \ref ejsplit_parse
+ * \param parts Parts of every thread
+ * \param nparts Number of parts (and threads)
+ *
+ * \returns Result containg info on how parsing went (see \ref ejresult).
+ *	Unlike \ref ejparse, \ref ejresult.ntoks is always the number of
+ *	tokens parsed. If the parts have more tokens together than fit in the
+ *	top-level array's \ref ejtok.len, it's an error with a NULL
+ *	\ref ejresult.loc.
+ */
+ejresult_t ejsplit_join(ejtok_t *t, const ejpart_t *parts, size_t nparts);
+
+/**
+ * \brief Copies JSON key/string to c string buffer unescaping along the way
+ *
+ * \warning If this function fails, the output buffer has undefined contents!
+ *
+ * \param tok_start Pointer to start of \ref ejtok_type.EJSTR or
+ *	\ref ejtok_type.EJKV token (first quote).
+ * \param out Pointer to where the escaped string should be copied to. This
+ *	buffer, even if not big enough for the resulting string, will always be
+ *	null-terminated. If left NULL, the function will just return the length
+ *	of the unescaped string.
+ * \param outlen Length of the buffer pointed to by \p out. If this is left 0
+ *	the function will only compute the length of the unescaped string and
+ *	return it.
+ *
+ * \returns Length of what the unescaped string would be if the buffer was
+ *	large enough, including null terminator.
+ *	\note This will be 0 if the string contains an invalid utf-8 codepoint
+ *	or mangled utf-8 surrogate pair.
+ */
+size_t ejstr(const char *tok_start, char *out, size_t outlen);
+
+/**
+ * \brief Same as \ref ejstr but for input that isn't null-terminated
+ *
+ * The 8 byte and SIMD loads of ejstr can read a little past the closing
+ * quote. This one never reads at or past \p tok_start + \p len, it goes
+ * byte by byte near the end instead.
+ *
+ * \param tok_start Pointer to start of a \ref ejtok_type.EJSTR or
+ *	\ref ejtok_type.EJKV token from \ref ejparse_n (first quote).
+ * \param len Length of the input from \p tok_start to its end
+ * \param out Same as in \ref ejstr
+ * \param outlen Same as in \ref ejstr
+ *
+ * \returns Same as \ref ejstr
+ */
+size_t ejstr_n(const char *tok_start, size_t len, char *out, size_t outlen);
+
+/**
+ * \brief Returns true if unescaped JSON string equals cstr
+ *
+ * Compares the string token to a normal c string, escaping characters as
+ * needed and returning whether or not they are equal.
+ *
+ * \param tok_start Pointer to start of \ref ejtok_type.EJSTR or
+ *	\ref ejtok_type.EJKV token (first quote).
+ * \param cstr Non-NULL pointer to null-terminated c string.
+ *
+ * \returns True if they match
+ */
+bool ejcmp(const char *tok_start, const char *cstr);
+
+/**
+ * \brief Same as \ref ejcmp but for input that isn't null-terminated
+ *
+ * Never reads at or past \p tok_start + \p len (see \ref ejstr_n).
+ *
+ * \param tok_start Pointer to start of a \ref ejtok_type.EJSTR or
+ *	\ref ejtok_type.EJKV token from \ref ejparse_n (first quote).
+ * \param len Length of the input from \p tok_start to its end
+ * \param cstr Non-NULL pointer to null-terminated c string.
+ *
+ * \returns True if they match
+ */
+bool ejcmp_n(const char *tok_start, size_t len, const char *cstr);
+
+/**
+ * \brief Hash table of the keys in an object (see \ref ejindex)
+ *
+ * Only for ekjson, the slots are in the buffer given to \ref ejindex.
+ */
+typedef struct ejindex {
+	const char *src;
+	const ejtok_t *obj;
+	uint64_t *slots;
+	size_t mask;
+} ejindex_t;
+
+/**
+ * \brief Makes a hash table of the keys in an object for \ref ejfind
+ *
+ * Finding a key with \ref ejcmp means comparing it to every key before it,
+ * so objects with lots of keys should be indexed with this first. The table
+ * is open addressed, with one slot for each of the hash and offset of a key.
+ * The keys are hashed after they are unescaped.
+ *
+ * \param index The index to set up
+ * \param src The source of the document that \p obj is from
+ * \param obj Pointer to a \ref ejtok_type.EJOBJ token
+ * \param hashes Hashes of the keys from \ref ejparse_hashes, where
+ *	\p hashes[0] is for \p obj, or NULL to hash the keys here
+ * \param slots Buffer for the table
+ * \param nslots Size of the buffer pointed to by \p slots. Has to be a power
+ *	of 2 that is more than the number of keys, and twice the number of keys
+ *	or more keeps lookups fast.
+ *
+ * \returns False if \p nslots is too small or not a power of 2, or if a
+ *	key is more than 4G tokens from \p obj (only with \ref EKJSON_LARGE)
+ */
+bool ejindex(ejindex_t *index, const char *src, const ejtok_t *obj,
+		const uint64_t *hashes, uint64_t *slots, size_t nslots);
+
+/**
+ * \brief Finds a key in an object indexed with \ref ejindex
+ *
+ * Gives the same key as comparing each key in order with \ref ejcmp would,
+ * so if a key is in the object more than once, the first one is found.
+ *
+ * \param index Index of the object
+ * \param key Non-NULL pointer to null-terminated c string.
+ *
+ * \returns The \ref ejtok_type.EJKV token of the key (the value is the
+ *	token after it), or NULL if it isn't in the object
+ */
+const ejtok_t *ejfind(const ejindex_t *index, const char *key);
+
+/**
+ * \brief Describes where a key of an object goes in a c struct (see
+ * \ref ejbind)
+ */
+typedef struct ejfield {
+	/**
+	 * \brief The key, a null-terminated c string
+	 */
+	const char *name;
+
+	/**
+	 * \brief What the member of the struct is
+	 *
+	 * - \ref ejtok_type.EJINT: A signed integer of 1, 2, 4 or 8 bytes
+	 * - \ref ejtok_type.EJFLT: A float or double, that ints can go in too
+	 * - \ref ejtok_type.EJSTR: A char buffer of \ref ejfield.size bytes
+	 * - \ref ejtok_type.EJBOOL: A bool
+	 * - \ref ejtok_type.EJOBJ: A struct described by \ref ejfield.obj
+	 */
+	enum ejtok_type type;
+
+	/**
+	 * \brief Offset of the member in the struct (from offsetof)
+	 */
+	size_t offset;
+
+	/**
+	 * \brief Size of the member in the struct (from sizeof)
+	 */
+	size_t size;
+
+	/**
+	 * \brief Schema of the struct for \ref ejtok_type.EJOBJ members
+	 */
+	const struct ejschema *obj;
+} ejfield_t;
+
+/**
+ * \brief Hash table of the fields of a struct (see \ref ejschema)
+ *
+ * Only for ekjson, the slots are in the buffer given to \ref ejschema.
+ */
+typedef struct ejschema {
+	const ejfield_t *fields;
+	size_t nfields;
+	uint64_t *slots;
+	size_t mask;
+} ejschema_t;
+
+/**
+ * \brief Makes a hash table of the fields of a struct for \ref ejbind
+ *
+ * The fields are only hashed once here, so that binding an object doesn't
+ * have to compare every key to every field name. Schemas of nested structs
+ * can be set up before or after the ones that point to them.
+ *
+ * \param schema The schema to set up
+ * \param fields The fields of the struct. Has to stay around for as long as
+ *	\p schema is used.
+ * \param nfields Number of fields pointed to by \p fields
+ * \param slots Buffer for the table
+ * \param nslots Size of the buffer pointed to by \p slots. Has to be a power
+ *	of 2 that is more than \p nfields.
+ *
+ * \returns False if \p nslots is too small or not a power of 2, or if a
+ *	field has a type or size that \ref ejbind can't fill in
+ */
+bool ejschema(ejschema_t *schema, const ejfield_t *fields, size_t nfields,
+		uint64_t *slots, size_t nslots);
+
+/**
+ * \brief Fills in a c struct from an object
+ *
+ * Each key that has a field in \p schema is converted with
+ * \ref ejint/\ref ejflt/\ref ejstr/\ref ejbool and put in its member, nested
+ * objects go into nested structs. Keys that aren't in the schema are
+ * skipped, null values leave their member as it is and so do keys that
+ * aren't in the object. If a key is in the object more than once, the last
+ * one wins.
+ *
+ * \param schema Schema of the struct from \ref ejschema
+ * \param src The source of the document that \p obj is from
+ * \param obj Pointer to a \ref ejtok_type.EJOBJ token
+ * \param hashes Hashes of the keys from \ref ejparse_hashes, where
+ *	\p hashes[0] is for \p obj, or NULL to hash the keys here
+ * \param out The struct to fill in
+ *
+ * \returns False if \p obj isn't an object, a value isn't the type of its
+ *	field, an int doesn't fit in its field or a string doesn't fit in its
+ *	buffer. Members before the bad value are still filled in.
+ */
+bool ejbind(const ejschema_t *schema, const char *src, const ejtok_t *obj,
+		const uint64_t *hashes, void *out);
+
+/**
+ * \brief Parses a document and fills in a c struct from it in one go
+ *
+ * Gives the same struct as \ref ejparse and then \ref ejbind on the root
+ * object would, but without a token buffer. Values are converted as soon as
+ * they're parsed and the values of keys that aren't in the schema are only
+ * checked, so the document is only gone through once and nothing is written
+ * other than the struct.
+ *
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing a JSON
+ *	object
+ * \param schema Schema of the struct from \ref ejschema
+ * \param out The struct to fill in
+ *
+ * \returns Result containg info on how parsing went (see \ref ejresult).
+ *	It's an error if the document isn't an object (so an empty one is,
+ *	even though \ref ejparse takes it) or \ref ejbind would have
+ *	returned false, \ref ejresult.ntoks is always 0.
+ */
+ejresult_t ejparse_bind(const char *src, const ejschema_t *schema,
+			void *out);
+
+/**
+ * \brief Finds the end of a value without parsing it
+ *
+ * Only the brackets and the quotes and backslashes of strings are looked at,
+ * nothing in the value is checked (mismatched brackets included). Objects and
+ * arrays are gone through a block at a time with the SIMD implementation in
+ * use (see \ref ejimpl), with the brackets inside of strings masked out, so
+ * this is a lot faster than parsing a value that is only going to be thrown
+ * away.
+ *
+ * \param tok_start Pointer to the start of a value in a null-terminated
+ *	document (like from a token or \ref ejcursor.val)
+ *
+ * \returns Pointer to the char right after the value, or NULL if the
+ *	document ends before the value does or \p tok_start isn't the start of
+ *	a value
+ */
+const char *ejskip(const char *tok_start);
+
+/**
+ * \brief Where a cursor is in a document (see \ref ejcursor)
+ *
+ * Cursors are small and copied around freely, a copy can be kept to go back
+ * to a value later.
+ */
+typedef struct ejcursor {
+	/**
+	 * \brief Start of the value the cursor is on (the tok_start for
+	 * functions like \ref ejstr and \ref ejint), NULL if there isn't one
+	 */
+	const char *val;
+
+	/**
+	 * \brief Start of the value's key if it is in an object, otherwise NULL
+	 */
+	const char *key;
+
+	/**
+	 * \brief Type of the value (EJKV is never used)
+	 */
+	enum ejtok_type type;
+} ejcursor_t;
+
+/**
+ * \brief Puts a cursor on the top-level value of a document
+ *
+ * Cursors go through a document without parsing it first or needing a token
+ * buffer. Only what it takes to move to a value is looked at: skipping a
+ * value only matches up its brackets and quotes without checking anything in
+ * it (see \ref ejskip), so the time it takes goes with how much of the
+ * document is read and not how big it is. The values that are landed on are
+ * only partially checked (like tokens from \ref ejparse), so reading them
+ * with ejstr, ejint, etc. is still needed, and a document with errors in
+ * parts that were skipped isn't turned away.
+ *
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON
+ *
+ * \returns Cursor on the top-level value, \ref ejcursor.val is NULL if there
+ *	isn't a value at the start of \p src
+ */
+ejcursor_t ejcursor(const char *src);
+
+/**
+ * \brief Moves a cursor to the first element of an array or member of an
+ * object
+ *
+ * \param c Cursor on an array or object
+ *
+ * \returns False if it's empty, not an array or object, or the first value
+ *	couldn't be read. The cursor isn't moved then.
+ */
+bool ejcursor_child(ejcursor_t *c);
+
+/**
+ * \brief Moves a cursor past its value to the next element or member
+ *
+ * \param c Cursor on a value in an array or object
+ *
+ * \returns False if it was the last one or there was an error, the cursor
+ *	isn't moved then
+ */
+bool ejcursor_next(ejcursor_t *c);
+
+/**
+ * \brief Moves a cursor from an object to the value of one of its keys
+ *
+ * Compares each key in order with \ref ejcmp, so if a key is in the object
+ * more than once, the first one is found.
+ *
+ * \param c Cursor on an object
+ * \param key Non-NULL pointer to null-terminated c string.
+ *
+ * \returns False if the key isn't in the object, the cursor isn't moved then
+ */
+bool ejcursor_find(ejcursor_t *c, const char *key);
+
+/**
+ * \brief Moves a cursor from an array to one of its elements
+ *
+ * \param c Cursor on an array
+ * \param i Index of the element
+ *
+ * \returns False if the array doesn't have that many elements, the cursor
+ *	isn't moved then
+ */
+bool ejcursor_at(ejcursor_t *c, size_t i);
+
+/**
+ * \brief One step of a path (see \ref ejfilter and \ref ejpath)
+ *
+ * Only for ekjson, the steps are in the buffer given to \ref ejfilter or
+ * \ref ejpath.
+ */
+typedef struct ejstep {
+	const char *name;
+	uint64_t hash;
+	uint32_t len, idx, child, next;
+	uint8_t kind;
+	bool whole;
+} ejstep_t;
+
+/**
+ * \brief Paths to parse out of documents (see \ref ejfilter)
+ *
+ * Only for ekjson, the steps are in the buffer given to \ref ejfilter.
+ */
+typedef struct ejfilter {
+	ejstep_t *steps;
+	size_t nsteps, cap;
+} ejfilter_t;
+
+/**
+ * \brief Compiles paths into a filter for \ref ejparse_filtered
+ *
+ * The paths are gone through once here and merged into a tree of steps, so
+ * that parsing a document only has to look for each key in the steps of the
+ * object it's in. A path is made of keys separated by '.', and [i] or [*]
+ * to go into element i or every element of an array, like "user.id",
+ * "items[*].price" or "[0].name". Keys can't have '.' or '[' in them, and the
+ * empty path is the whole document.
+ *
+ * \param filter The filter to set up
+ * \param paths The paths, null-terminated c strings. Have to stay around for
+ *	as long as \p filter is used.
+ * \param npaths Number of paths pointed to by \p paths
+ * \param steps Buffer for the steps
+ * \param nsteps Size of the buffer pointed to by \p steps. 1 plus the number
+ *	of steps in all of the paths is always enough, unless paths have both
+ *	[i] and [*] at the same place (elements with their own step get a copy
+ *	of the steps after [*]).
+ *
+ * \returns False if a path is malformed or \p nsteps is too small
+ */
+bool ejfilter(ejfilter_t *filter, const char *const *paths, size_t npaths,
+		ejstep_t *steps, size_t nsteps);
+
+/**
+ * \brief Parses only the parts of a document that a filter's paths go to
+ *
+ * Makes the same tokens as \ref ejparse would, except that members and
+ * elements that no path goes to are left out. Values at the end of a path
+ * are parsed whole, and objects and arrays that a path goes into only get
+ * the members and elements that the rest of the path goes to (they're
+ * still there if none of them are). Objects and arrays that no path goes to
+ * are jumped over with \ref ejskip without being checked, so when the parts
+ * of a document that aren't needed are mostly objects and arrays, this is
+ * a lot faster than parsing all of it. Other values that are left out are
+ * still checked, but nothing that is left out needs a token.
+ *
+ * \note Since elements that no path goes to are left out, the elements of
+ * an array in the tokens don't have the same indexes as in the document
+ * unless every element is kept (like with [*]).
+ *
+ * \param src Valid UTF-8/WTF-8 null-terminated string containing JSON
+ * \param filter Paths to parse from \ref ejfilter
+ * \param t Pointer to buffer to put the DOM into
+ * \param nt Size of the buffer pointed to by \p t
+ *
+ * \returns Result containg info on how parsing went (see \ref ejresult)
+ */
+ejresult_t ejparse_filtered(const char *src, const ejfilter_t *filter,
+				ejtok_t *t, size_t nt);
+
+/**
+ * \brief A path to look up in parsed documents (see \ref ejpath)
+ */
+typedef struct ejpath {
+	/**
+	 * \brief The steps, in the buffer given to \ref ejpath
+	 */
+	const ejstep_t *steps;
+
+	/**
+	 * \brief Number of steps (0 is the value the lookup starts at)
+	 */
+	size_t nsteps;
+} ejpath_t;
+
+/**
+ * \brief Compiles a path for \ref ejquery
+ *
+ * The path is only read once here, and the hash of each key is worked out
+ * ahead of time, so that the same path can be looked up in any number of
+ * documents without going through it again. Paths that start with a '/'
+ * are RFC 6901 JSON pointers, like "/items/0/price" (with ~0 for '~' and ~1
+ * for '/' in keys). Other paths are written like in \ref ejfilter, like
+ * "items[0].price", but can't have [*] in them. The empty path is the value
+ * the lookup starts at.
+ *
+ * \param path The path to set up
+ * \param expr The path, a null-terminated c string. Has to stay around for
+ *	as long as \p path is used.
+ * \param steps Buffer for the steps
+ * \param nsteps Size of the buffer pointed to by \p steps, 1 for each key
+ *	or index in the path
+ *
+ * \returns False if the path is malformed or \p nsteps is too small
+ */
+bool ejpath(ejpath_t *path, const char *expr, ejstep_t *steps, size_t nsteps);
+
+/**
+ * \brief Looks up a compiled path in a parsed document
+ *
+ * Goes down the tokens one step at a time, jumping over the members and
+ * elements before the one the step goes to with \ref ejtok.len, so nothing
+ * is read or written other than the tokens, keys and \p hashes. If a key is
+ * in an object more than once, the first one is found. A step in a JSON
+ * pointer that is an index (like 0 in "/a/0") goes to an element in arrays
+ * and to a key in objects.
+ *
+ * \param path Path from \ref ejpath
+ * \param src The source of the document that \p t is from
+ * \param t Token to start at, like the root of the document
+ * \param hashes Hashes of the keys from \ref ejparse_hashes, where
+ *	\p hashes[0] is for \p t. When given, keys are only compared if their
+ *	hashes are the same as the step's. Can be NULL.
+ *
+ * \returns The token of the value the path goes to, or NULL if it isn't in
+ *	the document
+ */
+const ejtok_t *ejquery(const ejpath_t *path, const char *src,
+			const ejtok_t *t, const uint64_t *hashes);
+
+/**
+ * \brief Converts int token to int64_t
+ *
+ * Parses base 10 integers.
+ *
+ * \param tok_start Pointer to start of \ref ejtok_type.EJINT.
+ *
+ * \returns String converted to int64_t. If the number is outside of the
+ * int64_t range, it will saturate it to the closest limit.
+ */
+int64_t ejint(const char *tok_start);
+
+/**
+ * \brief Same as \ref ejint but for input that isn't null-terminated
+ *
+ * The number ends at \p tok_start + \p len at the latest, and nothing past
+ * that is read. Numbers that end close to the end of the input get copied
+ * into a buffer on the stack first, which only fits the first 511 chars.
+ *
+ * \param tok_start Pointer to start of \ref ejtok_type.EJINT.
+ * \param len Length of the input from \p tok_start to its end
+ *
+ * \returns Same as \ref ejint
+ */
+int64_t ejint_n(const char *tok_start, size_t len);
+
+/**
+ * \brief Converts float token to double
+ *
+ * Parses base 10 ECMA-404 float literals. If the number in tok_start has a
+ * significand (after multiplying exponent) over \ref EKJSON_MAX_SIG, then the
+ * function will return nan. To get this with default \ref EKJSON_MAX_SIG value
+ * you would have to pass in a value with over ~100 sig figs with the max
+ * or minimum exponent values.
+ *
+ * \note Currently does not handle subnormal doubles. This may change in the
+ * future, but I kept it this way due to me wanting to use this in real time
+ * applications (where the subnormal overhead would be undesirable).
+ *
+ * \param tok_start Pointer to start of \ref ejtok_type.EJINT or
+ *	\ref ejtok_type.EJFLT.
+ *
+ * \returns String converted to double. If the number is outside of the
+ * double range, it will saturate to +/-INF.
+ */
+double ejflt(const char *tok_start);
+
+/**
+ * \brief Same as \ref ejflt but for input that isn't null-terminated
+ *
+ * Reads the input the same way as \ref ejint_n does.
+ *
+ * \param tok_start Pointer to start of \ref ejtok_type.EJINT or
+ *	\ref ejtok_type.EJFLT.
+ * \param len Length of the input from \p tok_start to its end
+ *
+ * \returns Same as \ref ejflt
+ */
+double ejflt_n(const char *tok_start, size_t len);
+
+/**
+ * \brief Returns \ref ejtok_type.EJBOOL true or false no error handling needed
+ */
+bool ejbool(const char *tok_start);
+
+/**
+ * \brief Implementations of the hot paths that ekjson can run with
+ *
+ * Each one changes how ejparse skips whitespace and strings, how ejstr and
+ * ejcmp go through plain runs of string chars, and how ejint and ejflt parse
+ * runs of 8 digits. They all give the exact same results. See
+ * \ref EKJSON_NO_SIMD.
+ */
+enum ejimpl {
+	/**
+	 * \brief The portable code (also see \ref EKJSON_NO_BITWISE)
+	 */
+	EJIMPL_SCALAR,
+
+	/**
+	 * \brief 16 byte blocks with SSE2
+	 */
+	EJIMPL_SSE2,
+
+	/**
+	 * \brief SSE2 plus the SSE4.2 string instructions and SSSE3 digit
+	 * parsing
+	 */
+	EJIMPL_SSE42,
+
+	/**
+	 * \brief 32 byte blocks with AVX2
+	 */
+	EJIMPL_AVX2,
+
+	/**
+	 * \brief 64 byte blocks with AVX-512BW
+	 */
+	EJIMPL_AVX512BW,
+
+	/**
+	 * \brief Not an implementation, tells \ref ejsetimpl to pick the best
+	 * one the cpu supports
+	 */
+	EJIMPL_AUTO
+};
+
+/**
+ * \brief Returns the implementation that ekjson is currently using
+ */
+enum ejimpl ejgetimpl(void);
+
+/**
+ * \brief Forces ekjson to use a specific implementation
+ *
+ * Mainly meant for benchmarks and tests. By default ekjson picks the best
+ * implementation the cpu supports at startup.
+ *
+ * \warning This is global state. Don't call this while other threads are
+ * using ekjson.
+ *
+ * \param impl Implementation to use or \ref ejimpl.EJIMPL_AUTO to go back to
+ *	the default.
+ *
+ * \returns False if the cpu (or the build, see \ref EKJSON_NO_SIMD) doesn't
+ *	support \p impl. The current implementation is kept in that case.
+ */
+bool ejsetimpl(enum ejimpl impl);
 
 #endif
 
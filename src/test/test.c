@@ -1,3 +1,6 @@
+// For memfd_create (see bigdoc)
+#define _GNU_SOURCE
+
 #include <float.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -5,6 +8,15 @@
 #include <limits.h>
 #include <time.h>
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define GUARDED 1
+#if SIZE_MAX > UINT32_MAX
+#define BIGDOC 1
+#endif
+#endif
+
 #include "../ekjson.h"
 #include "ek.h"
 
@@ -107,6 +119,1024 @@ static bool fail_overflow(unsigned id) {
 	return ejparse("[[[]]]", toks, arrlen(toks)).ntoks != 2;
 }
 
+// Makes n nested arrays/objects (alternating) with an int at the bottom
+static const char *nested(int n) {
+	static char buf[8 * 4096 + 2];
+	char *s = buf;
+	for (int i = 0; i < n; i++) {
+		s += sprintf(s, i % 2 ? "{\"k\":" : "[");
+	}
+	*s++ = '1';
+	for (int i = n - 1; i >= 0; i--) *s++ = i % 2 ? '}' : ']';
+	*s = '\0';
+	return buf;
+}
+static bool pass_deep(unsigned id) {
+	static ejtok_t toks[4096 * 2];
+	static ejframe_t stack[4096 + 1];	// +1 for the int
+	const char *src = nested(4096);
+	if (ejparse_deep(src, toks, arrlen(toks), stack, arrlen(stack)).err) {
+		return false;
+	}
+	// 2048 arrays, 2048 objects with a key and the int
+	return toks[0].len == 2048 * 3 + 1 && toks[2048 * 3].type == EJINT
+		&& toks[2048 * 3 - 1].type == EJKV
+		&& toks[2048 * 3 - 1].len == 2;
+}
+static bool fail_deep(unsigned id) {
+	static ejtok_t toks[EKJSON_MAX_DEPTH * 2 + 2];
+	return ejparse(nested(EKJSON_MAX_DEPTH), toks, arrlen(toks)).err
+		&& !ejparse(nested(EKJSON_MAX_DEPTH - 1), toks,
+			arrlen(toks)).err;
+}
+static bool fail_deep_stack(unsigned id) {
+	ejtok_t toks[64];
+	ejframe_t stack[8];
+	const ejresult_t res = ejparse_deep(nested(8), toks, arrlen(toks),
+					stack, arrlen(stack));
+	return res.err && *res.loc == '1';
+}
+
+// Feeds src to a streaming parser in chunks of n bytes
+static ejresult_t feed(const char *src, size_t n, ejtok_t *toks, size_t ntoks) {
+	ejframe_t stack[16];
+	ejparser_t p;
+	ejparser_init(&p, toks, ntoks, stack, arrlen(stack));
+	for (size_t len = strlen(src); len; ) {
+		const size_t chunk = len < n ? len : n;
+		const ejresult_t res = ejfeed(&p, src, chunk);
+		if (res.err) return res;
+		src += chunk, len -= chunk;
+	}
+	return ejfeed(&p, "", 0);
+}
+static bool pass_feed(unsigned id) {
+	static const char *const src = "{\"numbers\": [1, 2.5e3, -3],\n"
+		"\t\"name\": \"hel\\\"lo\\u00e9\", \"t\": true, "
+		"\"n\": [null, false, {}, []]} ";
+	ejtok_t toks[32], ftoks[16];
+	if (ejparse(src, toks, arrlen(toks)).err) return false;
+	for (size_t n = 1; n <= strlen(src); n++) {
+		const ejresult_t res = feed(src, n, ftoks, arrlen(ftoks));
+		if (res.err || res.ntoks != toks[0].len) return false;
+		if (memcmp(toks, ftoks, res.ntoks * sizeof(*toks))) return false;
+	}
+	return true;
+}
+static bool fail_feed(unsigned id) {
+	ejtok_t toks[16];
+	return feed("[\"abc", 2, toks, arrlen(toks)).err
+		&& feed("[1, 2", 1, toks, arrlen(toks)).err
+		&& feed("tru", 1, toks, arrlen(toks)).err
+		&& feed("1 2", 1, toks, arrlen(toks)).err
+		&& feed("-", 1, toks, arrlen(toks)).err;
+}
+static bool fail_feed_overflow(unsigned id) {
+	ejtok_t toks[2];
+	const ejresult_t res = feed("[[[]]]", 1, toks, arrlen(toks));
+	return res.full && res.ntoks == 2;
+}
+static bool fail_overflow_full(unsigned id) {
+	ejtok_t toks[2];
+	return ejparse("[[[]]]", toks, arrlen(toks)).full
+		&& !ejparse("[[[]", toks, arrlen(toks)).full;
+}
+static bool pass_big_offsets(unsigned id) {
+	if (SIZE_MAX <= UINT32_MAX) return true;
+
+	// Pretend that the first 4GB of the stream already went by, so that the
+	// '[' is the last offset that fits in 32 bits
+	ejtok_t toks[4];
+	ejframe_t stack[4];
+	ejparser_t p;
+	ejparser_init(&p, toks, arrlen(toks), stack, arrlen(stack));
+	p.pos = UINT32_MAX;
+	const char *const src = "[1]";
+	const ejresult_t res = ejfeed(&p, src, 3);
+#if EKJSON_LARGE
+	return !res.err && !ejfeed(&p, "", 0).err
+		&& toks[0].start == UINT32_MAX
+		&& toks[1].start == (uint64_t)UINT32_MAX + 1;
+#else
+	return res.err && !res.full && res.loc == src + 1 && res.ntoks == 1;
+#endif
+}
+static bool pass_big_indices(unsigned id) {
+#if EKJSON_LARGE
+	// Stand in for a container of more than 4G tokens, where the second
+	// member is past what a 32-bit index can hold (it's never read)
+	ejtok_t toks[2] = {
+		{ .type = EJARR, .len = ((uint64_t)1 << 32) + 3 },
+		{ .type = EJARR, .len = ((uint64_t)1 << 32) + 1 },
+	};
+	uint32_t idx[2];
+	if (ejelems(toks, idx, 2) != SIZE_MAX) return false;
+
+	uint64_t slots[4];
+	ejindex_t index;
+	toks[0].type = EJOBJ, toks[1].type = EJKV;
+	return !ejindex(&index, "", toks, NULL, slots, 4);
+#else
+	return true;
+#endif
+}
+#if BIGDOC
+// Makes "[", just over 4GB of spaces and then "1e999]" without using up the
+// memory for it, by mapping the same 1MB of spaces over and over. The offset
+// of the 1e999 is put in one.
+static const char *bigdoc(size_t *one) {
+	static const size_t chunk = 1 << 20, n = ((size_t)1 << 32) / chunk + 1;
+	static char *src;
+	*one = n * chunk + 1;
+	if (src) return src;
+
+	const int fd = memfd_create("ekjson_bigdoc", 0);
+	if (fd < 0 || ftruncate(fd, chunk)) return NULL;
+	char *const spaces = mmap(NULL, chunk, PROT_READ | PROT_WRITE,
+				MAP_SHARED, fd, 0);
+	if (spaces == MAP_FAILED) return NULL;
+	memset(spaces, ' ', chunk);
+	munmap(spaces, chunk);
+
+	// The first and last chunks are private so that they can be written
+	char *const doc = mmap(NULL, (n + 1) * chunk, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (doc == MAP_FAILED) return NULL;
+	for (size_t i = 1; i < n; i++) {
+		if (mmap(doc + i * chunk, chunk, PROT_READ, MAP_SHARED
+			| MAP_FIXED, fd, 0) == MAP_FAILED) return NULL;
+	}
+	close(fd);
+	memset(doc, ' ', chunk);
+	doc[0] = '[';
+	memcpy(doc + n * chunk, " 1e999]", 8);
+	return src = doc;
+}
+#endif
+static bool pass_big_validate(unsigned id) {
+#if BIGDOC
+	size_t one;
+	const char *const src = bigdoc(&one);
+	if (!src) return false;
+
+	// Only ejparse has to fit the offsets in its tokens
+	ejtok_t toks[4];
+	const ejresult_t res = ejparse(src, toks, arrlen(toks));
+#if EKJSON_LARGE
+	if (res.err || toks[1].start != one) return false;
+#else
+	if (!res.err || res.full || res.loc != src + one) return false;
+#endif
+	// 1e999 doesn't fit in a double, so it only fails with the checks on
+	return !ejvalidate(src, false).err && ejvalidate(src, true).err;
+#else
+	return true;
+#endif
+}
+#if GUARDED
+// Copies the len chars at src to the end of a page that has nothing mapped
+// after it, so that reading past them faults. Every call uses the same page.
+static const char *guarded(const char *src, size_t len) {
+	static char *page;
+	const size_t size = sysconf(_SC_PAGESIZE);
+	if (!page) {
+		char *const p = mmap(NULL, 2 * size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED || mprotect(p + size, size, PROT_NONE)) {
+			return NULL;
+		}
+		page = p;
+	}
+	return memcpy(page + size - len, src, len);
+}
+#endif
+static bool pass_guard_page(unsigned id) {
+#if GUARDED
+	static const char *const srcs[] = {
+		"\"abc\"", "12345", "[1, 2, \"x\"]", " {\"a\": [true, null]}  ",
+		"{\"key\": \"a string that is long enough to go past a whole "
+		"block of the document\", \"b\": -1.5e3}",
+	};
+	ejtok_t toks[16];
+	ejframe_t stack[4];
+	ejparser_t p;
+	for (size_t i = 0; i < arrlen(srcs); i++) {
+		const char *const src = guarded(srcs[i], strlen(srcs[i]) + 1);
+		if (!src || ejparse(src, toks, arrlen(toks)).err
+			|| ejvalidate(src, false).err) return false;
+		ejparser_init(&p, toks, arrlen(toks), stack, arrlen(stack));
+		if (ejparse_resume(&p, src).err) return false;
+	}
+#endif
+	return true;
+}
+static bool pass_guard_count(unsigned id) {
+#if GUARDED
+	static const char *const srcs[] = {
+		"\"abc\"", "12345", "[1, 2, \"x\"]", " {\"a\": [true, null]}  ",
+		"[\"a string that is long enough to go past a whole block of "
+		"the document\", {\"b\": \"\\\\\"}]",
+	};
+	for (size_t i = 0; i < arrlen(srcs); i++) {
+		const size_t len = strlen(srcs[i]);
+		const ejsize_t size = ejcount(srcs[i]);
+		const char *src = guarded(srcs[i], len + 1);
+		if (!src) return false;
+		const ejsize_t nul = ejcount(src);
+
+		// Without the null-terminator the last char is the one right
+		// before the unmapped page
+		src = guarded(srcs[i], len);
+		const ejsize_t n = ejcount_n(src, len);
+		if (nul.ntoks != size.ntoks || nul.depth != size.depth
+			|| n.ntoks != size.ntoks || n.depth != size.depth) {
+			return false;
+		}
+	}
+
+	static const char arr[] = "[[1], {\"a\": \"b\"}]";
+	const char *const src = guarded(arr, sizeof(arr));
+	return src && ejskip(src) == src + sizeof(arr) - 1;
+#else
+	return true;
+#endif
+}
+static bool pass_resume(unsigned id) {
+	static const char *const src = "{\"a\": [1, 2, {\"b\": null}], "
+		"\"c\": \"d\", \"e\": [[], {}]}";
+	ejtok_t toks[16], rtoks[16];
+	ejframe_t stack[4];
+	ejparser_t p;
+	if (ejparse(src, toks, arrlen(toks)).err) return false;
+
+	// Start with no room and give it 1 more token every time
+	size_t nt = 0;
+	ejresult_t res;
+	ejparser_init(&p, rtoks, nt, stack, arrlen(stack));
+	while ((res = ejparse_resume(&p, src)).full) {
+		if (res.ntoks != nt) return false;
+		ejparser_grow(&p, rtoks, ++nt);
+	}
+	return !res.err && res.ntoks == toks[0].len && nt == toks[0].len
+		&& !memcmp(toks, rtoks, res.ntoks * sizeof(*toks));
+}
+
+static bool pass_count(unsigned id) {
+	static const char *const srcs[] = {
+		"", " 1 ", "\"\\\\\"", "[true,false,null,-1.5e3]",
+		"{\"a\\\"{[\": [1, {}, []], \"b\\\\\": \"}]\\\\\"}",
+		"[\"a string that is long enough to go past a whole block of "
+		"the document, with \\\"{[escaped]}\\\" quotes\", 12345678]",
+		"{\"numbers\": [1, 2.5e3, -3],\n\t\"name\": \"hel\\\"lo\", "
+		"\"n\": [null, false, {\"x\": {}}, []]} ",
+	};
+	ejtok_t toks[32];
+	for (size_t i = 0; i < arrlen(srcs); i++) {
+		if (ejparse(srcs[i], toks, arrlen(toks)).err) return false;
+		const size_t ntoks = *srcs[i] ? toks[0].len : 0;
+		if (ejcount(srcs[i]).ntoks != ntoks) return false;
+	}
+	return ejcount(srcs[4]).depth == 3 && ejcount(srcs[6]).depth == 4;
+}
+static bool pass_count_deep(unsigned id) {
+	const ejsize_t size = ejcount(nested(4096));
+	return size.ntoks == 2048 * 3 + 1 && size.depth == 4096;
+}
+static bool pass_counts(unsigned id) {
+	static const char src[] = "{\"a\": [1, [], [2, {}], {\"b\": null}],"
+		" \"c\": {\"d\": [true, false, 3.5]}, \"e\": \"f\"}";
+	static const struct { unsigned tok, n; } expect[] = {
+		{ 0, 3 }, { 2, 4 }, { 4, 0 }, { 5, 2 }, { 7, 0 }, { 8, 1 },
+		{ 12, 1 }, { 14, 3 },
+	};
+	ejtok_t toks[24];
+	uint32_t counts[24];
+
+	if (ejparse_counts(src, toks, arrlen(toks), counts).err) return false;
+	if (toks[0].len != 20) return false;
+	for (size_t i = 0; i < arrlen(expect); i++) {
+		const ejtok_t *t = toks + expect[i].tok;
+		if (t->type != EJARR && t->type != EJOBJ) return false;
+		if (counts[expect[i].tok] != expect[i].n) return false;
+	}
+	return true;
+}
+static bool pass_parents(unsigned id) {
+	static const char src[] = "{\"a\": [1, {\"b\": null}, []],"
+		" \"c\": {\"d\": [true]}}";
+	static const uint32_t expect[] = {
+		UINT32_MAX, 0, 1, 2, 2, 4, 5, 2, 0, 8, 9, 10, 11,
+	};
+	ejtok_t toks[24], plain[24];
+	uint32_t parents[24];
+
+	if (ejparse_parents(src, toks, arrlen(toks), parents).err) return false;
+	if (ejparse(src, plain, arrlen(plain)).err) return false;
+	for (size_t i = 0; i < arrlen(expect); i++) {
+		if (parents[i] != expect[i]) return false;
+		if (toks[i].start != plain[i].start) return false;
+		if (toks[i].len != plain[i].len) return false;
+	}
+
+	// Put the path of the null back together from the bottom up
+	char path[16], *p = path + sizeof(path);
+	*--p = '\0';
+	for (uint32_t i = 6; parents[i] != UINT32_MAX; i = parents[i]) {
+		const uint32_t up = parents[i];
+		if (toks[up].type == EJKV) {
+			*--p = src[toks[up].start + 1];
+			*--p = '.';
+		} else if (toks[up].type == EJARR) {
+			char n = '0';
+			for (uint32_t j = up + 1; j < i; j += toks[j].len) n++;
+			*--p = ']', *--p = n, *--p = '[';
+		}
+	}
+	if (strcmp(p, ".a[1].b")) return false;
+
+	// Which has to lead back down to it
+	ejstep_t steps[4];
+	ejpath_t q;
+	if (!ejpath(&q, p + 1, steps, 4)) return false;
+	if (ejquery(&q, src, toks, NULL) != toks + 6) return false;
+
+	parents[0] = 0;
+	return !ejparse_parents("7", toks, arrlen(toks), parents).err
+		&& parents[0] == UINT32_MAX;
+}
+static bool pass_validate(unsigned id) {
+	// Has to be the same answer as ejparse gives
+	static const char *const srcs[] = {
+		"{\"a\": [1, [], [2, {}], {\"b\": null}], \"c\": \"\\u00e9\"}",
+		"[1, 2", "{\"a\" 1}", "[\"\\x\"]", "-", "tru", "7", " \"\" ",
+		"[[[[]]]]", "{}", "[] 1", "{\"a\": 1,}", "[1e5, -0.5, true]",
+	};
+	ejtok_t toks[32];
+	for (size_t i = 0; i < arrlen(srcs); i++) {
+		const bool err = ejparse(srcs[i], toks, arrlen(toks)).err;
+		if (ejvalidate(srcs[i], false).err != err) return false;
+		if (ejvalidate(srcs[i], true).err != err) return false;
+	}
+
+	// Only fail the checks that ejparse leaves for later when asked to
+	static const char *const later[] = {
+		"[\"\\ud800\"]", "{\"\\udc00\": 1}", "[1e999]", "-1e400",
+		"{\"a\": [\"\\ud83d\\u0041\"]}",
+	};
+	for (size_t i = 0; i < arrlen(later); i++) {
+		if (ejvalidate(later[i], false).err) return false;
+		if (!ejvalidate(later[i], true).err) return false;
+	}
+	return !ejvalidate("[\"\\ud83d\\ude00\", 1e300]", true).err;
+}
+static bool pass_strict(unsigned id) {
+	static const char *const good[] = {
+		"[\"caf\xc3\xa9\", \"\xe2\x82\xac\", \"\xf0\x9f\x98\x80\"]",
+		"{\"\xed\x9f\xbf\": \"\xef\xbf\xbf\xf4\x8f\xbf\xbf\"}",
+		"[\"\\ud83d\\ude00\", \"\\u00e9\\\\u\\n\", \"\\u0000\"]",
+	};
+	static const char *const bad[] = {
+		"[\"\xc0\x80\"]", "[\"\xe0\x80\x80\"]", "[\"\xed\xa0\x80\"]",
+		"[\"\xf4\x90\x80\x80\"]", "[\"\xf5\"]", "[\"a\x80\"]",
+		"{\"\xe2\x82\": 1}", "[\"\xf0\x9f\x98\"]", "[\"\\ud800\"]",
+		"[\"\\udc00\\ud800\"]", "[\"\\ud83d\\u0041\"]", "[\"\\ud83dx\"]",
+	};
+	ejtok_t toks[16];
+	for (size_t i = 0; i < arrlen(good); i++) {
+		if (ejparse_strict(good[i], toks, arrlen(toks)).err) return false;
+	}
+	for (size_t i = 0; i < arrlen(bad); i++) {
+		if (ejparse(bad[i], toks, arrlen(toks)).err) return false;
+		if (!ejparse_strict(bad[i], toks, arrlen(toks)).err) return false;
+	}
+
+	// Move a 3 byte char and a bad byte across the SIMD blocks
+	char src[96];
+	for (size_t i = 0; i < 70; i++) {
+		memset(src, 'a', sizeof(src));
+		memcpy(src, "[\"\xc3\xa9", 4);
+		memcpy(src + 4 + i, "\xe2\x82\xac", 3);
+		memcpy(src + 80, "\"]", 3);
+		if (ejparse_strict(src, toks, arrlen(toks)).err) return false;
+		src[4 + i + 2] = 'a';
+		const ejresult_t res = ejparse_strict(src, toks, arrlen(toks));
+		if (!res.err || res.loc != src + 4 + i) return false;
+	}
+	return true;
+}
+static bool pass_elems(unsigned id) {
+	static const char src[] = "[1, [2, 3], {\"a\": 4, \"b\": []}, \"x\"]";
+	static const uint32_t expect[] = { 1, 2, 5, 10 };
+	ejtok_t toks[16];
+	uint32_t idx[8];
+
+	if (ejparse(src, toks, arrlen(toks)).err) return false;
+	if (ejelems(toks, idx, arrlen(idx)) != arrlen(expect)) return false;
+	if (memcmp(idx, expect, sizeof(expect))) return false;
+	if (toks[idx[3]].type != EJSTR) return false;
+
+	// Keys of an object, and a buffer that is too small
+	if (ejelems(toks + 5, idx, arrlen(idx)) != 2) return false;
+	if (idx[0] != 1 || idx[1] != 3) return false;
+	idx[1] = 0;
+	return ejelems(toks, idx, 1) == 4 && idx[0] == 1 && idx[1] == 0
+		&& ejelems(toks + 9, idx, arrlen(idx)) == 0;
+}
+static bool pass_index(unsigned id) {
+	static const char src[] = "{\"id\": 1, \"name\": {\"id\": 2}, "
+		"\"a\\u0062\\n\": [3, 4], \"\": 5, \"id\": 6, \"caf\\u00e9\": 7}";
+	static const struct { const char *key; unsigned tok; } expect[] = {
+		{ "id", 1 }, { "name", 3 }, { "ab\n", 7 }, { "", 11 },
+		{ "caf\xc3\xa9", 15 }, { "nam", 0 }, { "ab", 0 }, { "x", 0 },
+	};
+	ejtok_t toks[24];
+	uint64_t slots[8];
+	ejindex_t index;
+
+	uint64_t hashes[24];
+
+	if (ejparse_hashes(src, toks, arrlen(toks), hashes).err) return false;
+	if (ejindex(&index, src, toks, NULL, slots, 6)) return false;
+	if (ejindex(&index, src, toks, NULL, slots, 4)) return false;
+
+	// The same with the keys hashed by ejindex and by ejparse_hashes
+	for (int h = 0; h < 2; h++) {
+		if (!ejindex(&index, src, toks, h ? hashes : NULL, slots, 8)) {
+			return false;
+		}
+		for (size_t i = 0; i < arrlen(expect); i++) {
+			const ejtok_t *t = ejfind(&index, expect[i].key);
+			if (t != (expect[i].tok ? toks + expect[i].tok : NULL)) {
+				return false;
+			}
+		}
+	}
+
+	// Long keys with escapes past the first 8 bytes
+	static const char src2[] = "{\"0123456789\\t\\u00e9abcdefgh\": 1, "
+		"\"01234567\": 2}";
+	if (ejparse_hashes(src2, toks, arrlen(toks), hashes).err) return false;
+	if (!ejindex(&index, src2, toks, hashes, slots, 4)) return false;
+	return ejfind(&index, "0123456789\t\xc3\xa9""abcdefgh") == toks + 1
+		&& ejfind(&index, "01234567") == toks + 3
+		&& !ejfind(&index, "0123456789");
+}
+static bool pass_bind(unsigned id) {
+	typedef struct { int16_t x; double y; } pos_t;
+	typedef struct {
+		char name[8];
+		int64_t id;
+		int8_t small;
+		float score;
+		bool on;
+		pos_t pos;
+	} rec_t;
+	static const ejfield_t posf[] = {
+		{ "x", EJINT, offsetof(pos_t, x), sizeof(int16_t) },
+		{ "y", EJFLT, offsetof(pos_t, y), sizeof(double) },
+	};
+	static ejschema_t pos;
+	static const ejfield_t recf[] = {
+		{ "name", EJSTR, offsetof(rec_t, name), 8 },
+		{ "id", EJINT, offsetof(rec_t, id), sizeof(int64_t) },
+		{ "small", EJINT, offsetof(rec_t, small), sizeof(int8_t) },
+		{ "score", EJFLT, offsetof(rec_t, score), sizeof(float) },
+		{ "on", EJBOOL, offsetof(rec_t, on), sizeof(bool) },
+		{ "pos", EJOBJ, offsetof(rec_t, pos), sizeof(pos_t), &pos },
+	};
+	static const ejfield_t badf[] = {
+		{ "x", EJINT, 0, 3 },
+	};
+	ejschema_t rec, bad;
+	uint64_t posslots[4], recslots[8], badslots[2];
+
+	if (ejschema(&rec, recf, arrlen(recf), recslots, 6)) return false;
+	if (ejschema(&rec, recf, arrlen(recf), recslots, 4)) return false;
+	if (ejschema(&bad, badf, arrlen(badf), badslots, 2)) return false;
+	if (!ejschema(&rec, recf, arrlen(recf), recslots, 8)) return false;
+	if (!ejschema(&pos, posf, arrlen(posf), posslots, 4)) return false;
+
+	static const char src[] = "{\"id\": -9000000000, \"extra\": [1, {}], "
+		"\"na\\u006de\": \"b\\u00e9n\", \"pos\": {\"y\": 2, "
+		"\"x\": -300, \"z\": 1}, \"score\": 1.5, \"on\": true, "
+		"\"small\": null, \"id\": 7}";
+	ejtok_t toks[32];
+	uint64_t hashes[32];
+	if (ejparse_hashes(src, toks, arrlen(toks), hashes).err) return false;
+
+	// The same with the keys hashed by ejbind and by ejparse_hashes
+	for (int h = 0; h < 2; h++) {
+		rec_t r = { .small = 5 };
+		if (!ejbind(&rec, src, toks, h ? hashes : NULL, &r)) {
+			return false;
+		}
+		if (strcmp(r.name, "b\xc3\xa9n") != 0) return false;
+		if (r.id != 7) return false;
+		if (r.small != 5 || r.score != 1.5f || !r.on) return false;
+		if (r.pos.x != -300 || r.pos.y != 2.0) return false;
+	}
+
+	// Values of the wrong type or that don't fit
+	static const char *const bads[] = {
+		"{\"small\": 128}", "{\"name\": \"12345678\"}",
+		"{\"id\": 1.0}", "{\"on\": 1}", "{\"pos\": []}",
+		"{\"pos\": {\"x\": \"1\"}}", "[]",
+	};
+	for (size_t i = 0; i < arrlen(bads); i++) {
+		rec_t r;
+		if (ejparse(bads[i], toks, arrlen(toks)).err) return false;
+		if (ejbind(&rec, bads[i], toks, NULL, &r)) return false;
+		if (!ejparse_bind(bads[i], &rec, &r).err) return false;
+	}
+
+	// Parsing and binding in one go gives the same struct
+	rec_t r = { .small = 5 };
+	if (ejparse_bind(src, &rec, &r).err) return false;
+	if (strcmp(r.name, "b\xc3\xa9n") != 0 || r.id != 7) return false;
+	if (r.small != 5 || r.score != 1.5f || !r.on) return false;
+	if (r.pos.x != -300 || r.pos.y != 2.0) return false;
+
+	// And still finds errors in the values that get skipped
+	static const char *const errs[] = {
+		"{\"extra\": [1, }", "{\"extra\": {\"a\" 1}}", "{\"id\": 1,,}",
+		"{\"id\": 1} 2", "{\"id\": 01}", "{\"extra\": \"\\x\"}",
+		"{\"extra\": nul}", "{\"pos\": {\"q\": [}}", "{\"extra\":",
+		"{\"id\"", "{", "",
+	};
+	for (size_t i = 0; i < arrlen(errs); i++) {
+		if (!ejparse_bind(errs[i], &rec, &r).err) return false;
+	}
+
+	// Commas are let through the same way as with ejparse
+	static const char *const loose[] = {
+		"{\"id\": 1,}", "{\"id\": 1 \"on\": true}",
+		"{\"pos\": {\"x\": 1,}, \"extra\": [1 2,],}",
+	};
+	for (size_t i = 0; i < arrlen(loose); i++) {
+		rec_t a, b;
+		memset(&a, 0, sizeof(a));
+		memset(&b, 0, sizeof(b));
+		if (ejparse(loose[i], toks, arrlen(toks)).err) return false;
+		if (!ejbind(&rec, loose[i], toks, NULL, &a)) return false;
+		if (ejparse_bind(loose[i], &rec, &b).err) return false;
+		if (memcmp(&a, &b, sizeof(a))) return false;
+	}
+	return !ejparse_bind(" {} ", &rec, &r).err
+		&& !ejparse_bind("{\"extra\": [[{}], {\"a\": [true]}]}",
+			&rec, &r).err;
+}
+static bool pass_skip(unsigned id) {
+	static const struct { const char *src; ptrdiff_t end; } ends[] = {
+		{ "[1, [2, \"]\"], {\"a\": \"\\\\\"}] ", 26 },
+		{ "\"a\\\"b\" ", 6 },
+		{ "\"\\\\\\\\\" ", 6 },
+		{ "-1.5e3,", 6 },
+		{ "true]", 4 },
+		{ "{\"[\": [\"{\", {}], \"}\": 1}x", 24 },
+	};
+	for (size_t i = 0; i < arrlen(ends); i++) {
+		if (ejskip(ends[i].src) != ends[i].src + ends[i].end) {
+			return false;
+		}
+	}
+
+	// Values that don't end, and things that aren't values
+	static const char *const bads[] = {
+		"[1, 2", "{\"a\": \"}\"", "\"abc", "\"abc\\\"", "\"", "}", ",",
+		" 1", "",
+	};
+	for (size_t i = 0; i < arrlen(bads); i++) {
+		if (ejskip(bads[i])) return false;
+	}
+
+	// Every value in a document ends right before a separator
+	static const char src[] = "{\"a\": [1, 2.5, \"x\\\\\", [[]], {}], "
+		"\"b\\\"\": {\"c\": [true, false, null], \"d\": \"]}\"}, "
+		"\"e\": -0}";
+	ejtok_t toks[32];
+	const ejresult_t res = ejparse(src, toks, arrlen(toks));
+	if (res.err) return false;
+	for (uint32_t i = 0; i < toks[0].len; i++) {
+		if (toks[i].type == EJKV) continue;
+		const char *end = ejskip(src + toks[i].start);
+		if (!end) return false;
+		while (*end == ' ') end++;
+		if (*end != ',' && *end != ']' && *end != '}' && *end) {
+			return false;
+		}
+	}
+	return true;
+}
+static bool pass_cursor(unsigned id) {
+	static const char src[] = " {\"skip\": [1, {\"a\": \"}]\\\"\"}, [[]]], "
+		"\"n\\u0061me\": \"x\", "
+		"\"list\": [10, 2.5, true, null, {}, []], "
+		"\"obj\": {\"k\": -3}, \"last\": false} ";
+	ejcursor_t c = ejcursor(src);
+	if (!c.val || c.type != EJOBJ || c.key) return false;
+
+	// Keys are found by going past the values before them
+	ejcursor_t k = c;
+	if (!ejcursor_find(&k, "name") || k.type != EJSTR) return false;
+	if (!ejcmp(k.val, "x") || !ejcmp(k.key, "name")) return false;
+	k = c;
+	if (!ejcursor_find(&k, "obj") || !ejcursor_find(&k, "k")) return false;
+	if (k.type != EJINT || ejint(k.val) != -3) return false;
+	k = c;
+	if (ejcursor_find(&k, "nope") || k.val != c.val) return false;
+
+	// Indexing and walking arrays
+	static const int types[] = {
+		EJINT, EJFLT, EJBOOL, EJNULL, EJOBJ, EJARR,
+	};
+	ejcursor_t a = c;
+	if (!ejcursor_find(&a, "list")) return false;
+	k = a;
+	if (!ejcursor_at(&k, 1) || ejflt(k.val) != 2.5 || k.key) return false;
+	k = a;
+	if (ejcursor_at(&k, 6) || k.val != a.val) return false;
+	size_t n = 0;
+	for (bool ok = ejcursor_child(&a); ok; ok = ejcursor_next(&a), n++) {
+		if (n >= arrlen(types) || a.type != (int)types[n]) return false;
+		if ((a.type == EJOBJ || a.type == EJARR)
+			&& ejcursor_child(&a)) {
+			return false;
+		}
+	}
+	if (n != arrlen(types)) return false;
+
+	// Walking the root object
+	n = 0;
+	for (bool ok = ejcursor_child(&c); ok; ok = ejcursor_next(&c)) n++;
+	if (n != 5 || c.type != EJBOOL || !ejcmp(c.key, "last")) return false;
+	if (ejcursor_next(&c)) return false;
+
+	// Values that are landed on are checked, skipped ones aren't
+	static const char *const bads[] = { "", "  ", "nul", "-", "\"a", "x" };
+	for (size_t i = 0; i < arrlen(bads); i++) {
+		if (ejcursor(bads[i]).val) return false;
+	}
+	c = ejcursor("[{\"a\" 1}, 1.]");
+	if (!ejcursor_child(&c) || ejcursor_child(&c)) return false;
+	if (ejcursor_next(&c)) return false;
+	c = ejcursor("[[1, x], 2]");
+	if (!ejcursor_at(&c, 1) || ejint(c.val) != 2) return false;
+	c = ejcursor("[[1, \"]\", 2");
+	if (ejcursor_at(&c, 1)) return false;
+
+	// Skip strings with brackets and escapes in them across the blocks
+	char buf[256];
+	for (size_t i = 0; i < 80; i++) {
+		memset(buf, ' ', sizeof(buf));
+		memcpy(buf, "[[{", 3);
+		memcpy(buf + 3 + i, "\"]\\\\\\\"}\\\\\"", 10);
+		memcpy(buf + 100 + i, "}], 7]", 7);
+		c = ejcursor(buf);
+		if (!ejcursor_at(&c, 1) || ejint(c.val) != 7) return false;
+	}
+	return true;
+}
+static bool pass_filtered(unsigned id) {
+	ejstep_t steps[16];
+	ejfilter_t f;
+
+	// Malformed paths and not enough steps
+	static const char *const bads[] = {
+		"a..b", ".a", "a.", "a[", "a[]", "a[x]", "[1", "a[1]b",
+		"[1234567890]",
+	};
+	for (size_t i = 0; i < arrlen(bads); i++) {
+		if (ejfilter(&f, bads + i, 1, steps, arrlen(steps))) {
+			return false;
+		}
+	}
+	static const char *const paths[] = {
+		"user.id", "items[*].price", "items[0].q",
+	};
+	if (ejfilter(&f, paths, arrlen(paths), steps, 6)) return false;
+	if (!ejfilter(&f, paths, arrlen(paths), steps, arrlen(steps))) {
+		return false;
+	}
+
+	// Only the members and elements on the paths get tokens
+	static const char src[] = "{\"user\": {\"id\": 7, \"name\": \"x\"}, "
+		"\"items\": [{\"price\": 1.5, \"q\": 2}, {\"q\": 3}, 4, "
+		"{\"price\": [1, {\"a\": \"}\"}]}], "
+		"\"skip\": {\"deep\": [[[\"]\"]]]}}";
+	static const struct {
+		int type;
+		uint32_t len;
+		const char *at;
+	} want[] = {
+		{ EJOBJ, 21, "{\"user\"" }, { EJKV, 4, "\"user\"" },
+		{ EJOBJ, 3, "{\"id\"" }, { EJKV, 2, "\"id\"" },
+		{ EJINT, 1, "7" },
+		{ EJKV, 16, "\"items\"" }, { EJARR, 15, "[{" },
+		{ EJOBJ, 5, "{\"price\": 1.5" }, { EJKV, 2, "\"price\"" },
+		{ EJFLT, 1, "1.5" }, { EJKV, 2, "\"q\": 2" }, { EJINT, 1, "2" },
+		{ EJOBJ, 1, "{\"q\": 3" }, { EJINT, 1, "4" },
+		{ EJOBJ, 7, "{\"price\": [" }, { EJKV, 6, "\"price\": [" },
+		{ EJARR, 5, "[1" }, { EJINT, 1, "1" }, { EJOBJ, 3, "{\"a\"" },
+		{ EJKV, 2, "\"a\"" }, { EJSTR, 1, "\"}\"" },
+	};
+	ejtok_t toks[48];
+	if (ejparse_filtered(src, &f, toks, arrlen(toks)).err) return false;
+	for (size_t i = 0; i < arrlen(want); i++) {
+		const char *const at = src + toks[i].start;
+		if (toks[i].type != want[i].type || toks[i].len != want[i].len
+			|| strncmp(at, want[i].at, strlen(want[i].at)) != 0) {
+			return false;
+		}
+	}
+	const ejresult_t full = ejparse_filtered(src, &f, toks, 21);
+	if (!full.err || !full.full) return false;
+
+	// The empty path is the whole document
+	static const char *const all[] = { "" };
+	if (!ejfilter(&f, all, 1, steps, 1)) return false;
+	ejtok_t ptoks[48];
+	if (ejparse_filtered(src, &f, toks, arrlen(toks)).err
+		|| ejparse(src, ptoks, arrlen(ptoks)).err) return false;
+	for (uint32_t i = 0; i < ptoks[0].len; i++) {
+		if (toks[i].type != ptoks[i].type || toks[i].len != ptoks[i].len
+			|| toks[i].start != ptoks[i].start) return false;
+	}
+
+	// [*] also goes into elements with their own steps, in any order
+	static const char *const idx[2][2] = {
+		{ "[*].a", "[1].b" }, { "[1].b", "[*].a" },
+	};
+	for (size_t i = 0; i < 2; i++) {
+		if (!ejfilter(&f, idx[i], 2, steps, arrlen(steps))) {
+			return false;
+		}
+		if (ejparse_filtered("[{\"a\": 1, \"b\": 2}, "
+			"{\"b\": 4, \"a\": 3}]", &f, toks, arrlen(toks)).err) {
+			return false;
+		}
+		if (toks[0].len != 9 || toks[1].len != 3 || toks[4].len != 5) {
+			return false;
+		}
+	}
+
+	// Keys are compared unescaped, and skipped values aren't checked
+	static const char *const name[] = { "name" };
+	if (!ejfilter(&f, name, 1, steps, arrlen(steps))) return false;
+	if (ejparse_filtered("{\"nam\": 1, \"na\\u006de\": 2, \"names\": 3, "
+		"\"x\": [1, x]}", &f, toks, arrlen(toks)).err
+		|| toks[0].len != 3 || toks[2].type != EJINT) return false;
+
+	// Skipped objects and arrays can end blocks after where they start
+	char buf[256];
+	for (size_t i = 0; i < 80; i++) {
+		memset(buf, ' ', sizeof(buf));
+		memcpy(buf, "{\"x\": [{\"]\": 1}", 15);
+		memcpy(buf + 100 + i, "], \"name\":  3}", 15);
+		if (ejparse_filtered(buf, &f, toks, arrlen(toks)).err
+			|| toks[0].len != 3
+			|| ejint(buf + toks[2].start) != 3) return false;
+	}
+	static const char *const errs[] = {
+		"{\"name\": 01}", "{\"name\": 1,}", "{\"x\": \"}",
+		"{\"name\": 1} 2",
+		"{\"x\": [1, 2}", "{\"x\" 1}", "{\"x\": }", "[", "",
+	};
+	for (size_t i = 0; i < arrlen(errs); i++) {
+		if (!ejparse_filtered(errs[i], &f, toks, arrlen(toks)).err) {
+			return false;
+		}
+	}
+	return true;
+}
+static bool pass_query(unsigned id) {
+	ejstep_t steps[8];
+	ejpath_t p;
+
+	// Malformed paths, [*] and not enough steps
+	static const char *const bads[] = {
+		"[*]", "a[*].b", "/a~2", "/a~", "a..b", "a[1",
+	};
+	for (size_t i = 0; i < arrlen(bads); i++) {
+		if (ejpath(&p, bads[i], steps, arrlen(steps))) return false;
+	}
+	if (ejpath(&p, "/a/b", steps, 1) || !ejpath(&p, "/a/b", steps, 2)) {
+		return false;
+	}
+
+	static const char src[] = "{\"a\": {\"b~/c\": [10, {\"x\": 1}, \"s\"], "
+		"\"0\": \"zero\", \"k\\u0065y\": true, \"a\": 1, \"a\": 2}, "
+		"\"list\": [[1, 2], [3, 4]]}";
+	static const struct {
+		const char *expr;
+		int type;
+		const char *at;
+	} finds[] = {
+		{ "", EJOBJ, "{" },
+		{ "/a/b~0~1c/1/x", EJINT, "1" }, { "a.b~/c[1].x", EJINT, "1" },
+		{ "/a/b~0~1c/2", EJSTR, "\"s\"" },
+		{ "/a/0", EJSTR, "\"zero\"" },
+		{ "/list/1/0", EJINT, "3" }, { "list[1][0]", EJINT, "3" },
+		{ "list", EJARR, "[[" }, { "/a/key", EJBOOL, "true" },
+		{ "a.a", EJINT, "1" },
+	};
+	static const char *const missing[] = {
+		"/a/nope", "/list/2", "/list/01", "/list/-", "a.b~/c[3]",
+		"list.0", "/a/0/0", "/", "a.b~/c.x", "[0]",
+	};
+	ejtok_t toks[32];
+	uint64_t hashes[32];
+	if (ejparse_hashes(src, toks, arrlen(toks), hashes).err) return false;
+
+	// The same with and without the hashes of the keys
+	for (int h = 0; h < 2; h++) {
+		for (size_t i = 0; i < arrlen(finds); i++) {
+			if (!ejpath(&p, finds[i].expr, steps, arrlen(steps))) {
+				return false;
+			}
+			const ejtok_t *const t = ejquery(&p, src, toks,
+						h ? hashes : NULL);
+			if (!t || t->type != finds[i].type
+				|| strncmp(src + t->start, finds[i].at,
+					strlen(finds[i].at)) != 0) return false;
+		}
+		for (size_t i = 0; i < arrlen(missing); i++) {
+			if (!ejpath(&p, missing[i], steps, arrlen(steps))
+				|| ejquery(&p, src, toks, h ? hashes : NULL)) {
+				return false;
+			}
+		}
+	}
+
+	// Lookups can start anywhere in the document
+	if (!ejpath(&p, "[0]", steps, arrlen(steps))) return false;
+	const ejtok_t *const t = ejquery(&p, src, toks + 23, hashes + 23);
+	return t && ejint(src + t->start) == 3;
+}
+static bool pass_parse_n(unsigned id) {
+	// Only the first len bytes are the document, the rest must not be read
+	static const char src[] = "[1, \"a\\\"b\", -2.5e1, {\"k\": 7}]9\"}";
+	const size_t len = sizeof(src) - 4;
+	ejtok_t toks[16], ntoks[16];
+	char buf[sizeof(src)];
+
+	memcpy(buf, src, len);
+	buf[len] = '\0';
+	if (ejparse(buf, toks, arrlen(toks)).err) return false;
+	const size_t n = toks[0].len;
+	const ejresult_t res = ejparse_n(src, len, ntoks, n);
+	if (res.err || res.ntoks != n || ejcount_n(src, len).ntoks != n) {
+		return false;
+	}
+	for (size_t i = 0; i < n; i++) {
+		if (ntoks[i].type != toks[i].type) return false;
+		if (ntoks[i].start != toks[i].start) return false;
+		if (ntoks[i].len != toks[i].len) return false;
+	}
+
+	// The ints and floats stop right before the end of their slices
+	if (ejint_n(src + 1, 1) != 1) return false;
+	if (ejflt_n(src + 12, 6) != -25.0) return false;
+	if (ejstr_n(src + 4, 6, buf, sizeof(buf)) != 4) return false;
+	if (strcmp(buf, "a\"b") != 0 || !ejcmp_n(src + 4, 6, "a\"b")) return false;
+
+	// Cutting the document short is an error instead of an overread
+	return ejparse_n(src, len - 1, ntoks, n).err
+		&& ejparse_n(src, 2, ntoks, n).err;
+}
+static bool pass_split(unsigned id) {
+	static const char *const srcs[] = {
+		"[{\"a\": [1, 2]}, \"x,\\\",y\", [[], {}], null, 3.5, "
+		"\"]\\\\\", {\"b\": \"[,\"}, true, -7, [\"\\\\\"]]",
+		" [ 1 , 2 ] ", "[]", "{\"a\": [1, 2], \"b\": 3}", "12",
+	};
+	ejtok_t toks[32], stoks[32];
+	ejpart_t parts[8];
+
+	// Parts are done one after another instead of on threads
+	for (size_t i = 0; i < arrlen(srcs); i++) {
+		const size_t len = strlen(srcs[i]);
+		if (ejparse(srcs[i], toks, arrlen(toks)).err) return false;
+		for (size_t n = 1; n <= arrlen(parts); n++) {
+			for (size_t j = 0; j < n; j++) {
+				ejsplit_scan(srcs[i], len, parts, n, j);
+			}
+			for (size_t j = 0; j < n; j++) {
+				ejsplit_parse(srcs[i], len, stoks,
+					arrlen(stoks), parts, n, j);
+			}
+			const ejresult_t res = ejsplit_join(stoks, parts, n);
+			if (res.err || res.ntoks != toks[0].len) return false;
+			for (size_t t = 0; t < res.ntoks; t++) {
+				if (stoks[t].type != toks[t].type) return false;
+				if (stoks[t].start != toks[t].start) return false;
+				if (stoks[t].len != toks[t].len) return false;
+			}
+		}
+	}
+
+	// Errors in any of the parts are errors for the whole document
+	static const char bad[] = "[1, 2, {\"a\": }, 3, 4]";
+	for (size_t j = 0; j < 4; j++) {
+		ejsplit_scan(bad, sizeof(bad) - 1, parts, 4, j);
+	}
+	for (size_t j = 0; j < 4; j++) {
+		ejsplit_parse(bad, sizeof(bad) - 1, stoks, arrlen(stoks),
+			parts, 4, j);
+	}
+	return ejsplit_join(stoks, parts, 4).err;
+}
+static bool pass_many(unsigned id) {
+	static const char src[] = "{\"a\": 1}\n[1, 2]\n\n  bad\n\"x\"\r\n"
+		"{} 1\n[\"abc\n3";
+	static const struct { size_t start, end, tok, ntoks; bool err; }
+	expect[] = {
+		{ 0, 8, 0, 3, false }, { 9, 15, 3, 3, false },
+		{ 19, 22, 6, 0, true }, { 23, 26, 6, 1, false },
+		{ 28, 32, 7, 0, true }, { 33, 38, 7, 0, true },
+		{ 39, 40, 7, 1, false },
+	};
+	ejtok_t toks[16];
+	ejdoc_t docs[8];
+
+	ejmany_t res = ejparse_many(src, toks, arrlen(toks),
+				docs, arrlen(docs));
+	if (res.ndocs != arrlen(expect) || res.ntoks != 8 || res.next) {
+		return false;
+	}
+	for (size_t i = 0; i < arrlen(expect); i++) {
+		if (docs[i].start != expect[i].start) return false;
+		if (docs[i].end != expect[i].end) return false;
+		if (docs[i].tok != expect[i].tok) return false;
+		if (docs[i].ntoks != expect[i].ntoks) return false;
+		if (docs[i].err != expect[i].err) return false;
+	}
+	if (toks[7].type != EJINT || toks[7].start != 39) return false;
+
+	// Stops right before the document that doesn't fit
+	res = ejparse_many(src, toks, 4, docs, arrlen(docs));
+	if (res.ndocs != 1 || res.ntoks != 3 || res.next != src + 9) {
+		return false;
+	}
+	res = ejparse_many(src, toks, arrlen(toks), docs, 2);
+	return res.ndocs == 2 && res.ntoks == 6 && res.next == src + 19;
+}
+
+#if EKJSON_THREADS
+// Checks that the shards of the pool have the same documents and tokens in
+// the same order as what ejparse_many gave
+static bool poolsame(const ejpool_t *pool, const char *src,
+		const ejtok_t *toks, const ejdoc_t *docs, size_t ndocs) {
+	size_t n = 0;
+	for (size_t i = 0; i < pool->nthreads; i++) {
+		const ejshard_t *s = pool->shards + i;
+		const size_t off = s->src - src;
+		for (const ejdoc_t *d = s->docs; d != s->docs + s->ndocs; d++) {
+			if (n == ndocs) return false;
+			const ejdoc_t *e = docs + n++;
+			if (d->start + off != e->start) return false;
+			if (d->end + off != e->end) return false;
+			if (d->ntoks != e->ntoks || d->err != e->err) {
+				return false;
+			}
+			for (size_t k = 0; k < d->ntoks; k++) {
+				const ejtok_t *a = s->t + d->tok + k;
+				const ejtok_t *b = toks + e->tok + k;
+				if (a->type != b->type || a->len != b->len
+					|| a->start + off != b->start) {
+					return false;
+				}
+			}
+		}
+	}
+	return n == ndocs;
+}
+
+static bool pass_pool(unsigned id) {
+	static const char src[] = "{\"a\": 1}\n[1, 2]\n\n  bad\n\"x\"\r\n"
+		"{} 1\n[\"abc\n3\n{\"b\": [true, null]}\n\n\n4.5\n"
+		"[{}, {\"c\": \"d\"}]\n";
+	ejtok_t toks[32];
+	ejdoc_t docs[16];
+	const ejmany_t res = ejparse_many(src, toks, arrlen(toks),
+					docs, arrlen(docs));
+
+	// Any number of threads gives the same documents in the same order,
+	// and so does parsing again with the buffers the pool already has
+	for (size_t nthreads = 1; nthreads <= 6; nthreads++) {
+		ejpool_t pool;
+		if (!ejpool_init(&pool, nthreads)) return false;
+		bool same = true;
+		for (int i = 0; i < 2; i++) {
+			same &= ejpool_many(&pool, src, sizeof(src) - 1);
+			same &= poolsame(&pool, src, toks, docs, res.ndocs);
+		}
+		ejpool_free(&pool);
+		if (!same) return false;
+	}
+	return true;
+}
+#endif
+
 PASS_SETUP(array_array_array_empty, "[[[]]]", 64)
 	CHECK_SIMPLE(EJARR, 1, 3)
 	CHECK_SIMPLE(EJARR, 1, 2)
@@ -749,6 +1779,17 @@ static bool pass_ejstr_overflow2(unsigned test) {
 	if (strcmp(buf, "ab") != 0) return TEST_BAD;
 	return true;
 }
+static bool pass_ejstr_overflow3(unsigned test) {
+	char buf[40];
+	const size_t len = ejstr("\"0123456789012345678901234567890123456789"
+				"0123456789012345678901234567890123456789\"",
+				buf, sizeof(buf));
+	if (len != 81) return TEST_BAD;
+	if (strcmp(buf, "012345678901234567890123456789012345678") != 0) {
+		return TEST_BAD;
+	}
+	return true;
+}
 
 extern char hell1_escaped[], hell1_string[];
 extern size_t hell1_size;
@@ -838,6 +1879,24 @@ static bool pass_ejcmp13(unsigned test) {
 static bool pass_ejcmp14(unsigned test) {
 	return !ejcmp("\"abcdef\"", "abcd");
 }
+static bool pass_ejcmp15(unsigned test) {
+	return !ejcmp("\"0123456789012345678901234567890123456789"
+			"0123456789012345678901234567890123456789\"",
+			"0123456789012345678901234567890123456789"
+			"012345678901234567890123456789012345678X");
+}
+static bool pass_ejcmp16(unsigned test) {
+	return ejcmp("\"0123456789012345678901234567890123456789"
+			"01234567890123456789012345678901234\\n6789\"",
+			"0123456789012345678901234567890123456789"
+			"01234567890123456789012345678901234\n6789");
+}
+static bool pass_ejcmp17(unsigned test) {
+	return ejcmp("\"a\\u0062c\"", "abc")
+		&& ejcmp("\"\\u00e9\\u20ac!\"", "\xc3\xa9\xe2\x82\xac!")
+		&& !ejcmp("\"a\\u0062c\"", "abd")
+		&& !ejcmp("\"a\\u0062\"", "a");
+}
 
 static bool pass_ejbool1(unsigned test) {
 	return ejbool("true") == true;
@@ -1056,6 +2115,38 @@ extern size_t flt_general_strings_len, flt_fast_strings_len,
 static const test_t tests[] = {
 	TEST_ADD(pass_nothing)
 	TEST_ADD(fail_overflow)
+	TEST_ADD(pass_deep)
+	TEST_ADD(fail_deep)
+	TEST_ADD(fail_deep_stack)
+	TEST_ADD(pass_feed)
+	TEST_ADD(fail_feed)
+	TEST_ADD(fail_feed_overflow)
+	TEST_ADD(fail_overflow_full)
+	TEST_ADD(pass_big_offsets)
+	TEST_ADD(pass_big_indices)
+	TEST_ADD(pass_big_validate)
+	TEST_ADD(pass_guard_page)
+	TEST_ADD(pass_guard_count)
+	TEST_ADD(pass_resume)
+	TEST_ADD(pass_count)
+	TEST_ADD(pass_count_deep)
+	TEST_ADD(pass_counts)
+	TEST_ADD(pass_parents)
+	TEST_ADD(pass_validate)
+	TEST_ADD(pass_strict)
+	TEST_ADD(pass_elems)
+	TEST_ADD(pass_index)
+	TEST_ADD(pass_bind)
+	TEST_ADD(pass_skip)
+	TEST_ADD(pass_cursor)
+	TEST_ADD(pass_filtered)
+	TEST_ADD(pass_query)
+	TEST_ADD(pass_parse_n)
+	TEST_ADD(pass_split)
+	TEST_ADD(pass_many)
+#if EKJSON_THREADS
+	TEST_ADD(pass_pool)
+#endif
 	TEST_PAD
 	TEST_ADD(pass_array_array_array_empty)
 	TEST_ADD(pass_array_array_empty)
@@ -1233,6 +2324,7 @@ static const test_t tests[] = {
 	TEST_PAD
 	TEST_ADD(pass_ejstr_overflow1)
 	TEST_ADD(pass_ejstr_overflow2)
+	TEST_ADD(pass_ejstr_overflow3)
 	TEST_PAD
 	TEST_ADD(pass_ejstr_hell1)
 	TEST_ADD(pass_ejstr_hell2)
@@ -1254,6 +2346,9 @@ static const test_t tests[] = {
 	TEST_ADD(pass_ejcmp12)
 	TEST_ADD(pass_ejcmp13)
 	TEST_ADD(pass_ejcmp14)
+	TEST_ADD(pass_ejcmp15)
+	TEST_ADD(pass_ejcmp16)
+	TEST_ADD(pass_ejcmp17)
 	TEST_PAD
 	TEST_ADD(pass_ejbool1)
 	TEST_ADD(pass_ejbool2)
@@ -1282,8 +2377,16 @@ int main(int argc, char **argv) {
 		}
 	}
 
-	int res = tests_run_foreach(NULL, tests, arrlen(tests), stdout)
-		? 0 : -1;
+	// Run the tests with every implementation the cpu supports
+	int res = 0;
+	for (int impl = EJIMPL_SCALAR; impl < EJIMPL_AUTO; impl++) {
+		if (!ejsetimpl(impl)) continue;
+		printf("implementation %d\n", impl);
+		if (!tests_run_foreach(NULL, tests, arrlen(tests), stdout)) {
+			res = -1;
+		}
+	}
+	ejsetimpl(EJIMPL_AUTO);
 	if (speed_test) {
 		test_ejstr_speed();
 		test_ejint_speed();
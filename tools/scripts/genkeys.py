@@ -0,0 +1,143 @@
+from random import Random
+from sys import argv
+
+# Constants for bits
+_U64MAX = (1 << 64) - 1
+_GOLDEN = 0x9E3779B97F4A7C15
+
+# Returns the first and last 8 bytes of a key as little endian words
+def key_words(key: bytes) -> tuple[int, int]:
+    m = min(len(key), 8)
+    return (int.from_bytes(key[:m], 'little'),
+            int.from_bytes(key[len(key) - m:], 'little'))
+
+# Same as the x in the generated c code
+def key_word(key: bytes) -> int:
+    (first, last) = key_words(key)
+    return ((first ^ len(key)) + last * _GOLDEN) & _U64MAX
+
+# Looks for a multiplier that puts every key in its own slot out of 2^bits
+# Returns the multiplier and bits
+def find_hash(keys: list[bytes]) -> tuple[int, int]:
+    words = [key_word(k) for k in keys]
+    if len(set(words)) != len(words):
+        for i in range(0, len(keys)):
+            for j in range(i + 1, len(keys)):
+                if words[i] == words[j]:
+                    raise ValueError(f'keys {keys[i]} and {keys[j]} have the'
+                                     + ' same length and first and last 8'
+                                     + ' bytes')
+
+    # Always the same output for the same keys
+    rng = Random(len(keys))
+    bits = max(1, (len(keys) - 1).bit_length())
+    while True:
+        for _ in range(0, 100000):
+            mul = rng.getrandbits(64) | 1
+            slots = set((w * mul & _U64MAX) >> (64 - bits) for w in words)
+            if len(slots) == len(words):
+                return (mul, bits)
+        bits += 1
+
+# Escapes a key so that it can go in a c string literal
+def cstr(key: bytes) -> str:
+    s = ''
+    for c in key:
+        if c == ord('"') or c == ord('\\'):
+            s += '\\' + chr(c)
+        elif c < 0x20 or c > 0x7E:
+            s += f'\\{c:03o}'
+        else:
+            s += chr(c)
+    return '"' + s + '"'
+
+# Makes the enum name of a key
+def cname(key: bytes) -> str:
+    name = ''
+    for c in key.decode('utf-8'):
+        name += c.upper() if c.isascii() and c.isalnum() else '_'
+    return (NAMESPACE + '_' + name).upper()
+
+# Makes the enum names of the keys, adding the index of the key to the ones
+# that would be the same as one before them
+def cnames(keys: list[bytes]) -> list[str]:
+    names = []
+    for (i, k) in enumerate(keys):
+        name = cname(k)
+        names.append(name + f'_{i}' if name in names else name)
+    return names
+
+def print_cfunc(keys: list[bytes]):
+    (mul, bits) = find_hash(keys)
+    slots = [-1] * (1 << bits)
+    for (i, k) in enumerate(keys):
+        slots[(key_word(k) * mul & _U64MAX) >> (64 - bits)] = i
+
+    print('// Ids of the keys')
+    print(f'enum {NAMESPACE}_key {{')
+    for name in cnames(keys):
+        print(f'\t{name},')
+    print(f'\t{NAMESPACE.upper()}_NKEYS,')
+    print('};\n')
+
+    print('// Returns the id of the key token at tok_start (first quote), or -1')
+    print('// if it isn\'t one of the keys. The length and first and last 8')
+    print('// bytes of the key pick the only key that it can be, and then ejcmp')
+    print('// makes sure that it\'s that one.')
+    print(f'static int {NAMESPACE}_key(const char *tok_start) {{')
+    print('\tstatic const char *const keys[] = {')
+    for k in keys:
+        print(f'\t\t{cstr(k)},')
+    print('\t};')
+    stype = ('signed char' if len(keys) < 128
+             else 'short' if len(keys) < 32768 else 'int')
+    print(f'\tstatic const {stype} slots[{len(slots)}] = {{')
+    for i in range(0, len(slots), 16):
+        row = ', '.join(str(x) for x in slots[i:i + 16])
+        print(f'\t\t{row},')
+    print('\t};\n')
+
+    print('\tconst char *const src = tok_start + 1;')
+    print('\tsize_t len = 0;')
+    print('\tfor (; src[len] != \'"\'; len++) {')
+    print('\t\t// Keys with escapes are rare, so just compare them')
+    print('\t\tif (src[len] != \'\\\\\') continue;')
+    print(f'\t\tfor (int i = 0; i < {NAMESPACE.upper()}_NKEYS; i++) {{')
+    print('\t\t\tif (ejcmp(tok_start, keys[i])) return i;')
+    print('\t\t}')
+    print('\t\treturn -1;')
+    print('\t}\n')
+
+    print('\tconst size_t m = len < 8 ? len : 8;')
+    print('\tuint64_t first = 0, last = 0;')
+    print('\tfor (size_t i = 0; i < m; i++) {')
+    print('\t\tfirst |= (uint64_t)(uint8_t)src[i] << i * 8;')
+    print('\t\tlast |= (uint64_t)(uint8_t)src[len - m + i] << i * 8;')
+    print('\t}')
+    print('\tconst uint64_t x = (first ^ len) + last'
+          + f' * 0x{_GOLDEN:X}ull;')
+    print(f'\tconst int id = slots[x * 0x{mul:016X}ull >> {64 - bits}];')
+    print('\treturn id >= 0 && ejcmp(tok_start, keys[id]) ? id : -1;')
+    print('}\n')
+
+# Only run code in cli mode
+if __name__ == '__main__':
+    # Make sure the user passed in keys to generate a function for
+    if len(argv) < 4:
+        print('usage:')
+        print('python3 genkeys.py "filename" "namespace" [keys...]')
+        exit(-1)
+
+    FILE_NAME = argv[1]
+    NAMESPACE = argv[2]
+    keys = [k.encode('utf-8') for k in argv[3:]]
+    if len(set(keys)) != len(keys):
+        raise ValueError('the same key was given more than once')
+
+    # Print out the C function
+    print('// Don\'t touch this file, this is auto generated by genkeys.py')
+    print('// Also include stdint.h and ekjson.h before this')
+    print(f'#ifndef _{FILE_NAME}_h_')
+    print(f'#define _{FILE_NAME}_h_\n')
+    print_cfunc(keys)
+    print(f'#endif // _{FILE_NAME}_h_')